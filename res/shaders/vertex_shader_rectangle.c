@@ -1,4 +1,6 @@
-uniform samplerBuffer PVMArray;
+uniform mat4 viewProjection;
+uniform int instanceBase; //where the render group's batch starts in the instance buffers
+uniform samplerBuffer TransformArray;
 uniform samplerBuffer ColorArray;
 
 uniform vec4 color;
@@ -11,12 +13,14 @@ out vec4 colorOut; //out going
 out vec2 texUV_out;
 
 void main() {
-	mat4 PVM = mat4(1.0f);
-	int offset = 4 * int(gl_InstanceID);
-	for(int i = 0; i < 4; ++i) {
-		PVM[i] = texelFetch(PVMArray, offset + i);
-	}
-    gl_Position = PVM * vec4(vertex, 1);
-    colorOut = texelFetch(ColorArray, gl_InstanceID);
+	//posDim is the centre & size, turn is the cos & sin of the angle and the z
+	int instance = instanceBase + int(gl_InstanceID);
+	int offset = 2 * instance;
+	vec4 posDim = texelFetch(TransformArray, offset + 0);
+	vec4 turn = texelFetch(TransformArray, offset + 1);
+	vec2 scaled = vertex.xy * posDim.zw;
+	vec2 turned = vec2(turn.x*scaled.x - turn.y*scaled.y, turn.y*scaled.x + turn.x*scaled.y);
+    gl_Position = viewProjection * vec4(turned + posDim.xy, vertex.z + turn.z, 1);
+    colorOut = texelFetch(ColorArray, instance);
     texUV_out = texUV;
 }
\ No newline at end of file
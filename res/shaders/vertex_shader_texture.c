@@ -1,4 +1,6 @@
-uniform samplerBuffer PVMArray;
+uniform mat4 viewProjection;
+uniform int instanceBase; //where the render group's batch starts in the instance buffers
+uniform samplerBuffer TransformArray;
 uniform samplerBuffer ColorArray;
 uniform samplerBuffer UVArray;
 // uniform vec4 color;
@@ -13,17 +15,17 @@ out float zAt;
 
 void main() {
 	
-	int offset = 4 * int(gl_InstanceID);
-	vec4 a = texelFetch(PVMArray, offset + 0);
-	vec4 b = texelFetch(PVMArray, offset + 1);
-	vec4 c = texelFetch(PVMArray, offset + 2);
-	vec4 d = texelFetch(PVMArray, offset + 3);
-	
-	mat4 PVM = mat4(a, b, c, d);
-    gl_Position = PVM * vec4(vertex, 1);
-    colorOut = texelFetch(ColorArray, gl_InstanceID);
+	//posDim is the centre & size, turn is the cos & sin of the angle and the z
+	int instance = instanceBase + int(gl_InstanceID);
+	int offset = 2 * instance;
+	vec4 posDim = texelFetch(TransformArray, offset + 0);
+	vec4 turn = texelFetch(TransformArray, offset + 1);
+	vec2 scaled = vertex.xy * posDim.zw;
+	vec2 turned = vec2(turn.x*scaled.x - turn.y*scaled.y, turn.y*scaled.x + turn.x*scaled.y);
+    gl_Position = viewProjection * vec4(turned + posDim.xy, vertex.z + turn.z, 1);
+    colorOut = texelFetch(ColorArray, instance);
 
-    vec4 uvQuad = texelFetch(UVArray, gl_InstanceID);
+    vec4 uvQuad = texelFetch(UVArray, instance);
 
     int xAt = int(texUV.x*2);
     int yAt = int(texUV.y*2) + 1;
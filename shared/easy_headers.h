@@ -11,6 +11,7 @@ static GameButton gameButtons[BUTTON_COUNT];
 
 #include "easy_files.h"
 #include "easy_math.h"
+#include "easy_random.h"
 #include "easy_error.h"
 #include "easy_array.h"
 #include "sdl_audio.h"
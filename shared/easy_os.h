@@ -155,14 +155,10 @@ void easyOS_endProgram(OSAppInfo *appInfo) {
 void easyOS_beginFrame(V2 resolution) {
 	glViewport(0, 0, resolution.x, resolution.y);
 
-	////Delete the storeage buffers from last frame 
-	//this is the pvm data and color data we send as tables to the GPU for the shader. 
-	for(int i = 0; i < lastStorageBufferCount; ++i) {
-	    BufferStorage *store = lastBufferStorage + i;
-	    deleteBufferStorage(store);
-	}
-	lastStorageBufferCount = 0;
-	//
+	//NOTE: the instance data lives in globalInstanceRing between frames, only the frame arena is let go
+	beginRenderFrameArena();
+	globalLastRenderStats = globalRenderStats;
+	zeroStruct(&globalRenderStats, RenderStats);
 }
 
 void easyOS_endFrame(V2 resolution, V2 screenDim, float *dt_, SDL_Window *windowHandle, unsigned int compositedFrameBufferId, unsigned int backBufferId, unsigned int renderbufferId, unsigned int *lastTime, float monitorFrameTime) {
@@ -192,7 +188,9 @@ void easyOS_endFrame(V2 resolution, V2 screenDim, float *dt_, SDL_Window *window
 	glBindFramebuffer(GL_READ_FRAMEBUFFER, compositedFrameBufferId); 
 	renderCheckError();
 	glBlitFramebuffer(0, 0, resolution.x, resolution.y, wResidue, yResidue, screenDim.x - wResidue, screenDim.y - yResidue, GL_COLOR_BUFFER_BIT, GL_LINEAR);
-	renderCheckError();                    
+	renderCheckError();
+	//NOTE: bound the framebuffers behind the render state cache
+	invalidateGLStateCache();                    
 	///////
    glViewport(0, 0, screenDim.x, screenDim.y);
    updateChannelVolumes(dt);
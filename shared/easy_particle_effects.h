@@ -1,10 +1,3 @@
-float randomBetween(float a, float b) { // including a and b
-    float result = ((float)rand() / (float)RAND_MAX);
-    assert(result >= 0 && result <= 1.0f);
-    result = lerp(a, result, b);
-    return result;
-}
-
 #define PART_SYS_TYPE(FUNC) \
 FUNC(PARTICLE_SYS_DEFAULT) \
 FUNC(PARTICLE_SYS_CIRCULAR) \
@@ -81,6 +74,8 @@ struct particle_system {
 
     ProjectionType viewType;
 
+    RandomSeries random;
+
     bool Active;
 };
 
@@ -111,9 +106,10 @@ internal inline particle_system_settings InitParticlesSettings(ParticleSystemTyp
     return Set;
 }
 
-internal inline void InitParticleSystem(particle_system *System, particle_system_settings *Set, unsigned int MaxParticleCount = DEFAULT_MAX_PARTICLE_COUNT) {
+internal inline void InitParticleSystem(particle_system *System, particle_system_settings *Set, uint64_t randomSeed, unsigned int MaxParticleCount = DEFAULT_MAX_PARTICLE_COUNT) {
     memset(System, 0, sizeof(particle_system));
     System->Set = *Set;
+    System->random = initRandomSeries(randomSeed);
     System->MaxParticleCount = DEFAULT_MAX_PARTICLE_COUNT;
     //System->Active = true;
     //System->Set.Loop = true;
@@ -176,17 +172,17 @@ internal inline void drawAndUpdateParticleSystem(particle_system *System, float
                 
                 //NOTE(oliver): Paricles start with motion 
                 Particle->scale = v3(1, 1, 1);
-                Particle->P = v3(randomBetween(System->Set.posBias.min.x, System->Set.posBias.max.x),
-                                  randomBetween(System->Set.posBias.min.y, System->Set.posBias.max.y),
+                Particle->P = v3(randomBetween(&System->random, System->Set.posBias.min.x, System->Set.posBias.max.x),
+                                  randomBetween(&System->random, System->Set.posBias.min.y, System->Set.posBias.max.y),
                                  0);
-                Particle->dP = v3(randomBetween(System->Set.VelBias.min.x, System->Set.VelBias.max.x),
-                                  randomBetween(System->Set.VelBias.min.y, System->Set.VelBias.max.y),
+                Particle->dP = v3(randomBetween(&System->random, System->Set.VelBias.min.x, System->Set.VelBias.max.x),
+                                  randomBetween(&System->random, System->Set.VelBias.min.y, System->Set.VelBias.max.y),
                                   0);
                 Particle->ddP = Acceleration;
                 Particle->lifeAt = 0;
 
-                Particle->angle = randomBetween(System->Set.angleBias.x, System->Set.angleBias.y);
-                Particle->dA = randomBetween(System->Set.angleForce.x, System->Set.angleForce.y);
+                Particle->angle = randomBetween(&System->random, System->Set.angleBias.x, System->Set.angleBias.y);
+                Particle->dA = randomBetween(&System->random, System->Set.angleForce.x, System->Set.angleForce.y);
 
                 Particle->bitmap = 0;
                 if(Set->BitmapCount > 0) {
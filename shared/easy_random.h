@@ -0,0 +1,51 @@
+/*
+    A small random number generator (PCG32, pcg-random.org) so each game or particle system carries its own state
+    instead of sharing rand(). The same seed always gives the same numbers, on any thread or platform.
+*/
+typedef struct {
+    uint64_t state;
+    uint64_t increment; //must be odd, picks which of the 2^63 streams we are on
+} RandomSeries;
+
+static inline uint32_t nextRandomU32(RandomSeries *series) {
+    uint64_t oldState = series->state;
+    series->state = oldState*6364136223846793005ULL + series->increment;
+    uint32_t xorShifted = (uint32_t)(((oldState >> 18u) ^ oldState) >> 27u);
+    uint32_t rotate = (uint32_t)(oldState >> 59u);
+    uint32_t result = (xorShifted >> rotate) | (xorShifted << ((-rotate) & 31));
+    return result;
+}
+
+static inline RandomSeries initRandomSeries(uint64_t seed, uint64_t stream = 0) {
+    RandomSeries result = {};
+    result.increment = (stream << 1u) | 1u;
+    nextRandomU32(&result);
+    result.state += seed;
+    nextRandomU32(&result);
+    return result;
+}
+
+//NOTE: 0 <= result < count, count has to be above 0
+static inline uint32_t randomIndex(RandomSeries *series, uint32_t count) {
+    assert(count > 0);
+    uint32_t result = (uint32_t)(((uint64_t)nextRandomU32(series)*count) >> 32);
+    return result;
+}
+
+//NOTE: 0 <= result < 1
+static inline float randomUnilateral(RandomSeries *series) {
+    float result = (float)(nextRandomU32(series) >> 8) * (1.0f / 16777216.0f);
+    return result;
+}
+
+//NOTE: 0 <= result <= 1
+static inline float randomUnilateralInclusive(RandomSeries *series) {
+    float result = (float)(nextRandomU32(series) >> 8) * (1.0f / 16777215.0f);
+    return result;
+}
+
+//NOTE: a <= result <= b
+static inline float randomBetween(RandomSeries *series, float a, float b) {
+    float result = lerp(a, randomUnilateralInclusive(series), b);
+    return result;
+}
@@ -40,6 +40,37 @@ typedef struct {
     char *name;
 } ShaderVal;
 
+//NOTE: The uniforms & attributes the renderer sets itself. Their locations are looked up by name once when the
+//program is made, so drawing never compares strings.
+#define SHADER_UNIFORM(FUNC) \
+FUNC(viewProjection) \
+FUNC(instanceBase) \
+FUNC(TransformArray) \
+FUNC(ColorArray) \
+FUNC(UVArray) \
+FUNC(tex) \
+FUNC(dir) \
+FUNC(percentY) \
+
+#define SHADER_ATTRIB(FUNC) \
+FUNC(vertex) \
+FUNC(texUV) \
+
+#define SHADER_SLOT_ENUM(value) SHADER_SLOT_##value,
+
+typedef enum {
+    SHADER_UNIFORM(SHADER_SLOT_ENUM)
+    SHADER_UNIFORM_COUNT
+} ShaderUniform;
+
+typedef enum {
+    SHADER_ATTRIB(SHADER_SLOT_ENUM)
+    SHADER_ATTRIB_COUNT
+} ShaderAttrib;
+
+static char *ShaderUniformStrings[] = { SHADER_UNIFORM(STRING) };
+static char *ShaderAttribStrings[] = { SHADER_ATTRIB(STRING) };
+
 typedef struct {
     GLuint glProgram;
     GLuint glShaderV;
@@ -51,9 +82,23 @@ typedef struct {
     ShaderVal attribs[16];
     int attribCount;
     
+    s32 uniformSlots[SHADER_UNIFORM_COUNT]; //-1 if the program doesn't have it
+    s32 attribSlots[SHADER_ATTRIB_COUNT];
+    
     bool valid;
 } RenderProgram;
 
+//NOTE: Counts for one frame, easyOS_beginFrame moves them to globalLastRenderStats and starts again.
+typedef struct {
+    int shaderNameLookups; //getUniformFromProgram & getAttribFromProgram, should be 0 once the programs are made
+    int drawCalls;
+    int glStateCallsIssued; //state changes that went to the driver
+    int glStateCallsSkipped; //state changes globalGLState already had
+} RenderStats;
+
+static RenderStats globalRenderStats = {};
+static RenderStats globalLastRenderStats = {};
+
 RenderProgram lineProgram;
 RenderProgram rectangleProgram;
 RenderProgram rectangleNoGradProgram;
@@ -123,6 +168,99 @@ typedef enum {
     BLEND_FUNC_ZERO_ONE_ZERO_ONE_MINUS_ALPHA,
 } BlendFuncType;
 
+/*
+    The GL state the renderer last set, so a batch that wants what the batch before it had doesn't go to the driver
+    again. Anything that binds behind the cache's back (making textures, framebuffers & buffers, the blit at the end
+    of the frame) calls invalidateGLStateCache, then the next call of each kind goes through.
+    
+    Texture units 0-2 hold the instance buffers & 3 the texture, see drawVao.
+*/
+#define GL_STATE_TEXTURE_UNITS 4
+#define GL_STATE_UNKNOWN 0xFFFFFFFF
+
+typedef struct {
+    GLuint frameBuffer;
+    GLuint depthTest;
+    GLuint blendFunc;
+    GLuint program;
+    GLuint activeTexture;
+    GLuint textures[GL_STATE_TEXTURE_UNITS];
+} GLStateCache;
+
+static GLStateCache globalGLState = {};
+
+void invalidateGLStateCache() {
+    globalGLState.frameBuffer = GL_STATE_UNKNOWN;
+    globalGLState.depthTest = GL_STATE_UNKNOWN;
+    globalGLState.blendFunc = GL_STATE_UNKNOWN;
+    globalGLState.program = GL_STATE_UNKNOWN;
+    globalGLState.activeTexture = GL_STATE_UNKNOWN;
+    for(int unit = 0; unit < GL_STATE_TEXTURE_UNITS; ++unit) {
+        globalGLState.textures[unit] = GL_STATE_UNKNOWN;
+    }
+}
+
+//NOTE: Returns true if the call has to go to GL, & remembers the new value.
+static inline bool updateGLState(GLuint *cached, GLuint value) {
+    bool result = (*cached != value);
+    if(result) {
+        *cached = value;
+        globalRenderStats.glStateCallsIssued++;
+    } else {
+        globalRenderStats.glStateCallsSkipped++;
+    }
+    return result;
+}
+
+static inline void setGLFrameBuffer(GLuint frameBuffer) {
+    if(updateGLState(&globalGLState.frameBuffer, frameBuffer)) {
+        glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+    }
+}
+
+static inline void setGLDepthTest(bool depthTest) {
+    if(updateGLState(&globalGLState.depthTest, depthTest ? 1 : 0)) {
+        if(depthTest) {
+            glEnable(GL_DEPTH_TEST);
+        } else {
+            glDisable(GL_DEPTH_TEST);
+        }
+    }
+}
+
+static inline void setGLBlendFunc(BlendFuncType blendFuncType) {
+    if(updateGLState(&globalGLState.blendFunc, blendFuncType)) {
+        switch(blendFuncType) {
+            case BLEND_FUNC_ZERO_ONE_ZERO_ONE_MINUS_ALPHA: {
+                glBlendFuncSeparate(GL_ZERO, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+            } break;
+            case BLEND_FUNC_STANDARD: {
+                glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+            } break;
+            default: {
+                assert(!"case not handled");
+            }
+        }
+    }
+}
+
+static inline void setGLProgram(GLuint program) {
+    if(updateGLState(&globalGLState.program, program)) {
+        glUseProgram(program);
+    }
+}
+
+//NOTE: only changes the active unit when the bind has to happen
+static inline void setGLTexture(int unit, GLenum target, GLuint textureId) {
+    assert(unit >= 0 && unit < GL_STATE_TEXTURE_UNITS);
+    if(updateGLState(&globalGLState.textures[unit], textureId)) {
+        if(updateGLState(&globalGLState.activeTexture, GL_TEXTURE0 + unit)) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+        }
+        glBindTexture(target, textureId);
+    }
+}
+
 typedef struct {
     GLuint vaoHandle;
     int indexCount; // this is to keep around so opnegl knows how many triangles to draw after the initialization frame
@@ -143,6 +281,30 @@ static unsigned int globalQuadIndicesData[6] = {0, 1, 3, 0, 2, 3};
 
 static VaoHandle globalQuadVaoHandle = {};
 
+//NOTE: Vertex & index data that doesn't change, render items point at it instead of having a copy. The vertexes are
+//only read when the item's VaoHandle is made.
+typedef struct {
+    Vertex *triangleData;
+    int triCount;
+    unsigned int *indicesData;
+    int indexCount;
+} RenderGeometry;
+
+/*
+    Everything the renderer needs for one frame, the render items, the sort and the instance data of each batch, is
+    pushed on here and it's all let go in easyOS_beginFrame. So drawing doesn't malloc or free.
+*/
+#define RENDER_FRAME_ARENA_SIZE Megabytes(64)
+static Arena globalRenderFrameArena = {};
+
+void beginRenderFrameArena() {
+    if(!globalRenderFrameArena.memory) {
+        globalRenderFrameArena = createArena(RENDER_FRAME_ARENA_SIZE);
+    }
+    assert(globalRenderFrameArena.markCount == 0);
+    globalRenderFrameArena.currentSize = 0;
+}
+
 typedef struct {
     GLuint id;
     int width;
@@ -151,12 +313,29 @@ typedef struct {
     
 } Texture;
 
+//NOTE: Where an instance of the unit quad goes before the view projection of its batch: scaled by dim, turned by the
+//angle and moved to pos. It goes to the shaders as two vec4s in TransformArray instead of a whole PVM matrix.
 typedef struct {
-    InfiniteAlloc triangleData;
-    int triCount; 
-    
-    InfiniteAlloc indicesData; 
-    int indexCount; 
+    V2 pos;
+    V2 dim;
+    float cosAngle;
+    float sinAngle;
+    float zAt;
+    float unused;
+} InstanceTransform;
+
+static inline InstanceTransform instanceTransform(V3 pos, V2 dim, float angle) {
+    InstanceTransform result = {};
+    result.pos = pos.xy;
+    result.dim = dim;
+    result.cosAngle = cos(angle);
+    result.sinAngle = sin(angle);
+    result.zAt = pos.z;
+    return result;
+}
+
+typedef struct {
+    RenderGeometry *geometry;
     
     RenderProgram *program; 
     ShapeType type; 
@@ -164,7 +343,8 @@ typedef struct {
     u32 textureHandle;
     Rect2f textureUVs;    
 
-    Matrix4 PVM; 
+    InstanceTransform transform;
+    int viewProjectionIndex; //into the group's viewProjections
     float zAt;
     
     int id;
@@ -186,13 +366,22 @@ typedef struct {
     BlendFuncType blendFuncType;
     
     int idAt; 
-    InfiniteAlloc items; //type: RenderItem
+    //NOTE: Both on the frame arena. They double in size when full, the old ones are left there until the next frame.
+    RenderItem *items;
+    int itemCount;
+    int itemCapacity;
+    
+    //NOTE: Items mostly come in runs with the same projection & view, so they are only multiplied when they change
+    Matrix4 *viewProjections;
+    int viewProjectionCount;
+    int viewProjectionCapacity;
+    Matrix4 lastProjection;
+    Matrix4 lastView;
     
 } RenderGroup;
 
 RenderGroup initRenderGroup() {
     RenderGroup result = {};
-    result.items = initInfinteAlloc(RenderItem);
     result.currentDepthTest = true;
     result.blendFuncType = BLEND_FUNC_STANDARD;
     return result;  
@@ -217,34 +406,45 @@ void setBlendFuncType(RenderGroup *group, BlendFuncType type) {
 
 static RenderGroup globalRenderGroup = {};
 
-void pushRenderItem(VaoHandle *handles, RenderGroup *group, Vertex *triangleData, int triCount, unsigned int *indicesData, int indexCount, RenderProgram *program, ShapeType type, Texture *texture, Matrix4 PVM, V4 color, float zAt) {
-    if(!isInfinteAllocActive(&group->items)) {
-        group->items = initInfinteAlloc(RenderItem);
+//NOTE: Makes room for one more, count is how many there are now
+static inline void *growFrameArray(void *array, int count, int *capacity, size_t sizeOfMember) {
+    void *result = array;
+    if(count == *capacity) {
+        int newCapacity = (*capacity) ? 2*(*capacity) : 1024;
+        result = pushSize(&globalRenderFrameArena, newCapacity*sizeOfMember);
+        if(count > 0) {
+            memcpy(result, array, count*sizeOfMember);
+        }
+        *capacity = newCapacity;
+    }
+    return result;
+}
+
+int getViewProjectionIndex(RenderGroup *group, Matrix4 projectionMatrix, Matrix4 viewMatrix) {
+    int count = group->viewProjectionCount;
+    if(count == 0 || memcmp(&group->lastProjection, &projectionMatrix, sizeof(Matrix4)) != 0 || memcmp(&group->lastView, &viewMatrix, sizeof(Matrix4)) != 0) {
+        group->viewProjections = (Matrix4 *)growFrameArray(group->viewProjections, count, &group->viewProjectionCapacity, sizeof(Matrix4));
+        group->viewProjections[group->viewProjectionCount++] = Mat4Mult(projectionMatrix, viewMatrix);
+        group->lastProjection = projectionMatrix;
+        group->lastView = viewMatrix;
     }
+    int result = group->viewProjectionCount - 1;
+    return result;
+}
+
+void pushRenderItem(VaoHandle *handles, RenderGroup *group, RenderGeometry *geometry, RenderProgram *program, ShapeType type, Texture *texture, InstanceTransform transform, Matrix4 projectionMatrix, Matrix4 viewMatrix, V4 color, float zAt) {
+    int viewProjectionIndex = getViewProjectionIndex(group, projectionMatrix, viewMatrix);
     
-    RenderItem *info = (RenderItem *)addElementInifinteAlloc_(&group->items, 0);
-    assert(info);
+    group->items = (RenderItem *)growFrameArray(group->items, group->itemCount, &group->itemCapacity, sizeof(RenderItem));
+    RenderItem *info = group->items + group->itemCount++;
+    zeroStruct(info, RenderItem);
     info->bufferId = group->currentBufferId;
     info->depthTest = group->currentDepthTest;
     info->blendFuncType = group->blendFuncType;
     info->bufferHandles = handles;
     info->color = color;
     info->zAt = zAt;
-    
-    info->triangleData = initInfinteAlloc(Vertex);
-    info->triCount = triCount; 
-    
-    for(int triIndex = 0; triIndex < triCount; ++triIndex) {
-        addElementInifinteAlloc_(&info->triangleData, &triangleData[triIndex]);
-    }
-    
-    info->indicesData = initInfinteAlloc(unsigned int); 
-    
-    for(int indicesIndex = 0; indicesIndex < indexCount; ++indicesIndex) {
-        addElementInifinteAlloc_(&info->indicesData, &indicesData[indicesIndex]);
-    }
-    
-    info->indexCount = indexCount;
+    info->geometry = geometry;
     
     info->id = group->idAt++;
     
@@ -255,7 +455,8 @@ void pushRenderItem(VaoHandle *handles, RenderGroup *group, Vertex *triangleData
         assert(info->textureHandle);
         info->textureUVs = texture->uvCoords;
     } 
-    info->PVM = PVM;
+    info->transform = transform;
+    info->viewProjectionIndex = viewProjectionIndex;
 }
 
 RenderProgram createRenderProgram(char *vShaderSource, char *fShaderSource) {
@@ -275,7 +476,7 @@ RenderProgram createRenderProgram(char *vShaderSource, char *fShaderSource) {
     glAttachShader(result.glProgram, result.glShaderV);
     glAttachShader(result.glProgram, result.glShaderF);
     glLinkProgram(result.glProgram);
-    glUseProgram(result.glProgram);
+    setGLProgram(result.glProgram);
     
     int  vlength,    flength,    plength;
     char vlog[2048];
@@ -316,6 +517,7 @@ void renderCheckError_(int lineNumber, char *fileName) {
     } ShaderValInfo;
     
     ShaderValInfo getAttribFromProgram(RenderProgram *prog, char *name) {
+        globalRenderStats.shaderNameLookups++;
         ShaderValInfo result = {};
         for(int i = 0; i < prog->attribCount; ++i) {
             ShaderVal *val = prog->attribs + i;
@@ -330,6 +532,7 @@ void renderCheckError_(int lineNumber, char *fileName) {
     }
     
     ShaderValInfo getUniformFromProgram(RenderProgram *prog, char *name) {
+        globalRenderStats.shaderNameLookups++;
         ShaderValInfo result = {};
         for(int i = 0; i < prog->uniformCount; ++i) {
             ShaderVal *val = prog->uniforms + i;
@@ -346,6 +549,41 @@ void renderCheckError_(int lineNumber, char *fileName) {
         return result;
     }
     
+    static inline s32 findShaderVal(ShaderVal *vals, int count, char *name) {
+        s32 result = -1;
+        for(int i = 0; i < count; ++i) {
+            if(cmpStrNull(name, vals[i].name)) {
+                result = vals[i].handle;
+                break;
+            }
+        }
+        return result;
+    }
+    
+    void resolveShaderSlots(RenderProgram *prog) {
+        for(int slot = 0; slot < SHADER_UNIFORM_COUNT; ++slot) {
+            prog->uniformSlots[slot] = findShaderVal(prog->uniforms, prog->uniformCount, ShaderUniformStrings[slot]);
+        }
+        for(int slot = 0; slot < SHADER_ATTRIB_COUNT; ++slot) {
+            prog->attribSlots[slot] = findShaderVal(prog->attribs, prog->attribCount, ShaderAttribStrings[slot]);
+        }
+    }
+    
+    static inline s32 getUniformSlot(RenderProgram *prog, ShaderUniform slot) {
+        s32 result = prog->uniformSlots[slot];
+        if(result < 0) {
+            printf("%s\n", ShaderUniformStrings[slot]);
+        }
+        assert(result >= 0);
+        return result;
+    }
+    
+    static inline s32 getAttribSlot(RenderProgram *prog, ShaderAttrib slot) {
+        s32 result = prog->attribSlots[slot];
+        assert(result >= 0);
+        return result;
+    }
+    
     GLuint renderGetUniformLocation(RenderProgram *program, char *name) {
         GLuint result = glGetUniformLocation(program->glProgram, name);
         renderCheckError();
@@ -420,6 +658,7 @@ RenderProgram createProgramFromFile(char *vertexShaderFilename, char *fragmentSh
     
     findAttribsAndUniforms(&result, vertStream, true);
     findAttribsAndUniforms(&result, fragStream, false);
+    resolveShaderSlots(&result);
     
     free(vertStream);
     free(fragStream);
@@ -539,6 +778,7 @@ V3 transformScreenPToWorldP(V2 inputA, float zPos, V2 resolution, V2 screenDim,
 }
 
 void enableRenderer(int width, int height) {
+    beginRenderFrameArena();
 #if RENDER_BACKEND == OPENGL_BACKEND
     glViewport(0, 0, width, height);
     renderCheckError();
@@ -565,6 +805,8 @@ void enableRenderer(int width, int height) {
 #if DESKTOP
     glEnable(GL_MULTISAMPLE);
 #endif
+    //NOTE: nothing is known about the state until each kind has been set once through the cache
+    invalidateGLStateCache();
     
     char *append = concat(globalExeBasePath, (char *)"shaders/");
     
@@ -647,6 +889,7 @@ GLuint renderLoadTexture(int width, int height, void *imageData) {
     
     glBindTexture(GL_TEXTURE_2D, 0);
     renderCheckError();
+    invalidateGLStateCache();
 #endif
     return resultId;
 }
@@ -659,10 +902,13 @@ typedef struct {
 
 void renderDeleteTextures(int count, GLuint *handle) {
 	glDeleteTextures(1, handle);
+	invalidateGLStateCache();
 }
 
 void renderDeleteFramebuffers(int count, GLuint *handle) {
 	glDeleteFramebuffers(1, handle);
+	//NOTE: GL goes back to framebuffer 0 if this one was bound
+	invalidateGLStateCache();
 }
 
 void deleteFrameBuffer(FrameBuffer *frameBuffer) {
@@ -722,6 +968,7 @@ FrameBuffer createFrameBuffer(int width, int height, int flags) {
     renderCheckError();
     
     assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+    invalidateGLStateCache();
     
     FrameBuffer result = {};
     result.textureId = mainTexture;
@@ -773,6 +1020,7 @@ FrameBuffer createFrameBufferMultiSample(int width, int height, int flags, int s
     renderCheckError();
     
     assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+    invalidateGLStateCache();
     
     FrameBuffer result = {};
     result.textureId = textureId;
@@ -782,7 +1030,7 @@ FrameBuffer createFrameBufferMultiSample(int width, int height, int flags, int s
 }
 
 void clearBufferAndBind(u32 bufferHandle, V4 color) {
-    glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)bufferHandle); 
+    setGLFrameBuffer((GLuint)bufferHandle); 
     
     setFrameBufferId(&globalRenderGroup, bufferHandle);
     
@@ -800,9 +1048,9 @@ typedef enum {
 } DrawCallType;
 
 static V2 globalBlurDir = {};
-void drawVao(VaoHandle *bufferHandles, Vertex *triangleData, int triCount, unsigned int *indicesData, int indexCount_, RenderProgram *program, ShapeType type, u32 textureId, u32 PVMId, u32 colorId, u32 uvsId, V4 color, DrawCallType drawCallType, int instanceCount) {
+void drawVao(VaoHandle *bufferHandles, Vertex *triangleData, int triCount, unsigned int *indicesData, int indexCount_, RenderProgram *program, ShapeType type, u32 textureId, Matrix4 *viewProjection, int instanceBase, u32 transformId, u32 colorId, u32 uvsId, V4 color, DrawCallType drawCallType, int instanceCount) {
     
-    glUseProgram(program->glProgram);
+    setGLProgram(program->glProgram);
     renderCheckError();
     
     GLuint vaoHandle;  
@@ -852,40 +1100,45 @@ void drawVao(VaoHandle *bufferHandles, Vertex *triangleData, int triCount, unsig
         }
     }
     
-    GLint pvmUniform = getUniformFromProgram(program, "PVMArray").handle;
-    //GLint pvmUniform = glGetUniformLocation(programId, "PVMArray");
+    GLint viewProjectionUniform = getUniformSlot(program, SHADER_SLOT_viewProjection);
+    renderCheckError();
+    
+    glUniformMatrix4fv(viewProjectionUniform, 1, GL_FALSE, viewProjection->val);
+    renderCheckError();
+    
+    GLint instanceBaseUniform = getUniformSlot(program, SHADER_SLOT_instanceBase);
+    renderCheckError();
+    
+    glUniform1i(instanceBaseUniform, instanceBase);
     renderCheckError();
     
-    glUniform1i(pvmUniform, 0);
+    GLint transformUniform = getUniformSlot(program, SHADER_SLOT_TransformArray);
     renderCheckError();
-    glActiveTexture(GL_TEXTURE0);
+    
+    glUniform1i(transformUniform, 0);
     renderCheckError();
     
-    glBindTexture(GL_TEXTURE_BUFFER, PVMId); 
+    setGLTexture(0, GL_TEXTURE_BUFFER, transformId); 
     renderCheckError();
     
-    GLint colorUniform = getUniformFromProgram(program, "ColorArray").handle;
+    GLint colorUniform = getUniformSlot(program, SHADER_SLOT_ColorArray);
     // GLint colorUniform = glGetUniformLocation(programId, "ColorArray");
     renderCheckError();
     
     glUniform1i(colorUniform, 1);
     renderCheckError();
-    glActiveTexture(GL_TEXTURE1);
-    renderCheckError();
     
-    glBindTexture(GL_TEXTURE_BUFFER, colorId); 
+    setGLTexture(1, GL_TEXTURE_BUFFER, colorId); 
     renderCheckError();
 
     if(uvsId) {
-        GLint uvUniform = getUniformFromProgram(program, "UVArray").handle;
+        GLint uvUniform = getUniformSlot(program, SHADER_SLOT_UVArray);
         renderCheckError();
 
         glUniform1i(uvUniform, 2);
         renderCheckError();
-        glActiveTexture(GL_TEXTURE2);
-        renderCheckError();
         
-        glBindTexture(GL_TEXTURE_BUFFER, uvsId); 
+        setGLTexture(2, GL_TEXTURE_BUFFER, uvsId); 
         renderCheckError();
     }
     
@@ -909,22 +1162,20 @@ void drawVao(VaoHandle *bufferHandles, Vertex *triangleData, int triCount, unsig
     }
     
     if(type == SHAPE_TEXTURE || type == SHAPE_SHADOW || type == SHAPE_BLUR) {
-        GLint texUniform = getUniformFromProgram(program, "tex").handle;
+        GLint texUniform = getUniformSlot(program, SHADER_SLOT_tex);
         //GLint texUniform = glGetUniformLocation(programId, "tex");
         renderCheckError();
         
         glUniform1i(texUniform, 3);
         renderCheckError();
-        glActiveTexture(GL_TEXTURE3);
-        renderCheckError();
         
         // printf("texture id: %d\n", textureId);
-        glBindTexture(GL_TEXTURE_2D, textureId); 
+        setGLTexture(3, GL_TEXTURE_2D, textureId); 
         renderCheckError();
         
         if(type == SHAPE_BLUR) {
             //GLint directionUniform = glGetUniformLocation(programId, "dir");
-            GLint directionUniform = getUniformFromProgram(program, "dir").handle;
+            GLint directionUniform = getUniformSlot(program, SHADER_SLOT_dir);
             glUniform2f(directionUniform, globalBlurDir.x, globalBlurDir.y);
         }
         
@@ -948,17 +1199,17 @@ void drawVao(VaoHandle *bufferHandles, Vertex *triangleData, int triCount, unsig
         }
         
     } else if(type == SHAPE_LINE || type == SHAPE_CIRCLE) {
-        GLint percentUniform = getUniformFromProgram(program, "percentY").handle;
+        GLint percentUniform = getUniformSlot(program, SHADER_SLOT_percentY);
         //GLint percentUniform = glGetUniformLocation(programId, "percentY");
         renderCheckError();
     }
     
     if(initialization)  {
         //these can also be retrieved before hand to speed up the process!!!
-        GLint vertexAttrib = getAttribFromProgram(program, "vertex").handle;
+        GLint vertexAttrib = getAttribSlot(program, SHADER_SLOT_vertex);
         //GLint vertexAttrib = glGetAttribLocation(programId, "vertex");
         renderCheckError();
-        GLint texUVAttrib = getAttribFromProgram(program, "texUV").handle;
+        GLint texUVAttrib = getAttribSlot(program, SHADER_SLOT_texUV);
         // assert(texUVAttrib > 0);
         // GLint texUVAttrib = glGetAttribLocation(program->id, "texUV");
         renderCheckError();
@@ -1018,8 +1269,7 @@ void drawVao(VaoHandle *bufferHandles, Vertex *triangleData, int triCount, unsig
         glDeleteVertexArrays(1, &vaoHandle);
     }
     
-    glUseProgram(0);
-    
+    //NOTE: the program stays bound, the next drawVao with the same one skips glUseProgram
 }
 
 void getQuadVertexes(Vertex *triangleData) { //has to be length of four
@@ -1034,21 +1284,25 @@ void getQuadVertexes(Vertex *triangleData) { //has to be length of four
     triangleData[3].texUV = v2(1, 1);
 }
 
+static Vertex globalQuadVertexData[4] = {};
+static RenderGeometry globalQuadGeometry = {};
+
+RenderGeometry *getQuadGeometry() {
+    if(!globalQuadGeometry.triangleData) {
+        getQuadVertexes(globalQuadVertexData);
+        globalQuadGeometry.triangleData = globalQuadVertexData;
+        globalQuadGeometry.triCount = arrayCount(globalQuadVertexData);
+        globalQuadGeometry.indicesData = globalQuadIndicesData;
+        globalQuadGeometry.indexCount = arrayCount(globalQuadIndicesData);
+    }
+    return &globalQuadGeometry;
+}
+
 void renderDrawRectOutlineCenterDim(V3 center, V2 dim, V4 color, float rot, Matrix4 offsetTransform, Matrix4 projectionMatrix) {
     V3 deltaP = transformPositionV3(center, offsetTransform);
     
     float a1 = cos(rot);
     float a2 = sin(rot);
-    float b1 = cos(rot + HALF_PI32);
-    float b2 = sin(rot + HALF_PI32);
-    
-    Matrix4 rotationMat = {{
-            a1,  a2,  0,  0,
-            b1,  b2,  0,  0,
-            0,  0,  1,  0,
-            deltaP.x, deltaP.y, deltaP.z,  1
-        }};
-    
     
     V2 halfDim = v2(0.5f*dim.x, 0.5f*dim.y);
     
@@ -1074,24 +1328,14 @@ void renderDrawRectOutlineCenterDim(V3 center, V2 dim, V4 color, float rot, Matr
     };
     
     float thickness = 0.1;
-
-    Vertex triangleData[4] = {};
-    if(!globalQuadVaoHandle.valid) {
-        getQuadVertexes(triangleData);
-    }
     
     for(int i = 0; i < 4; ++i) {
         float rotat = rotations[i];
-        float halfLen = 0.5f*lengths[i];
         V2 offset = offsets[i];
-        
-        Matrix4 rotationMat1 = {{
-                thickness*cos(rotat),  thickness*sin(rotat),  0,  0,
-                lengths[i]*-sin(rotat),  lengths[i]*cos(rotat),  0,  0,
-                0,  0,  1,  0,
-                offset.x, offset.y, 0,  1
-            }};
-        pushRenderItem(&globalQuadVaoHandle, &globalRenderGroup, triangleData, arrayCount(triangleData), globalQuadIndicesData, arrayCount(globalQuadIndicesData), &rectangleProgram, SHAPE_RECTANGLE, 0, Mat4Mult(projectionMatrix, Mat4Mult(rotationMat, rotationMat1)), color, center.z);
+        //NOTE: the side's offset is turned with the whole rect
+        V3 sideP = v3(deltaP.x + a1*offset.x - a2*offset.y, deltaP.y + a2*offset.x + a1*offset.y, deltaP.z);
+        InstanceTransform transform = instanceTransform(sideP, v2(thickness, lengths[i]), rot + rotat);
+        pushRenderItem(&globalQuadVaoHandle, &globalRenderGroup, getQuadGeometry(), &rectangleProgram, SHAPE_RECTANGLE, 0, transform, projectionMatrix, mat4(), color, center.z);
     }
 }
 
@@ -1101,31 +1345,13 @@ void renderDrawRectOutlineRect2f(Rect2f rect, V4 color, float rot, Matrix4 offse
 
 //
 void renderDrawRectCenterDim_(V3 center, V2 dim, V4 *colors, float rot, Matrix4 offsetTransform, Texture *texture, ShapeType type, RenderProgram *program, Matrix4 viewMatrix, Matrix4 projectionMatrix) {
-    float a1 = cos(rot);
-    float a2 = sin(rot);
-    float b1 = cos(rot + HALF_PI32);
-    float b2 = sin(rot + HALF_PI32);
-    
     V3 deltaP = transformPositionV3(center, offsetTransform);
-    Matrix4 rotationMat = {{
-            dim.x*a1,  dim.x*a2,  0,  0,
-            dim.y*b1,  dim.y*b2,  0,  0,
-            0,  0,  1,  0,
-            deltaP.x, deltaP.y, deltaP.z,  1
-        }};
+    InstanceTransform transform = instanceTransform(deltaP, dim, rot);
     
-    Vertex triangleData[4] = {};
-    if(!globalQuadVaoHandle.valid) {
-        getQuadVertexes(triangleData);
-
-    }
     if(globalImmediateModeGraphics) {
     } else {
-        int triCount = arrayCount(triangleData);
-        int indicesCount = arrayCount(globalQuadIndicesData);
-        pushRenderItem(&globalQuadVaoHandle, &globalRenderGroup, triangleData, triCount, 
-            globalQuadIndicesData, indicesCount, program, type, texture, 
-            Mat4Mult(projectionMatrix, Mat4Mult(viewMatrix, rotationMat)), colors[0], center.z);
+        pushRenderItem(&globalQuadVaoHandle, &globalRenderGroup, getQuadGeometry(), program, type, texture, 
+            transform, projectionMatrix, viewMatrix, colors[0], center.z);
     }    
 }
 
@@ -1174,10 +1400,11 @@ void renderDeleteVaoHandle(VaoHandle *handles) {
     handles->refresh = false;
 }
 
-RenderItem *getRenderItem(RenderGroup *group, int index) {
+//NOTE: index into the order sortItems put them in
+RenderItem *getRenderItem(RenderItem **sortedItems, int itemCount, int index) {
     RenderItem *info = 0;
-    if(index < group->items.count) {
-        info = (RenderItem *)getElementFromAlloc_(&group->items, index);
+    if(index < itemCount) {
+        info = sortedItems[index];
     }
     return info;
 }
@@ -1187,14 +1414,14 @@ typedef struct {
     GLuint buffer;
 } BufferStorage;
 
-BufferStorage createBufferStorage(InfiniteAlloc *array) {
+BufferStorage createBufferStorage(void *memory, size_t sizeInBytes) {
     BufferStorage result = {};
     glGenBuffers(1, &result.tbo);
     renderCheckError();
     // printf("TBO: %d\n", result.tbo);
     glBindBuffer(GL_TEXTURE_BUFFER, result.tbo);
     renderCheckError();
-    glBufferData(GL_TEXTURE_BUFFER, array->sizeOfMember*array->count, array->memory, GL_DYNAMIC_DRAW);
+    glBufferData(GL_TEXTURE_BUFFER, sizeInBytes, memory, GL_STREAM_DRAW);
     renderCheckError();
     
     glGenTextures(1, &result.buffer);
@@ -1204,6 +1431,7 @@ BufferStorage createBufferStorage(InfiniteAlloc *array) {
     
     glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, result.tbo);
     renderCheckError();
+    invalidateGLStateCache();
     
     return result;
 }
@@ -1211,6 +1439,7 @@ BufferStorage createBufferStorage(InfiniteAlloc *array) {
 void deleteBufferStorage(BufferStorage *store) {
     // printf("buffer id: %d\n", store->buffer);
     glDeleteTextures(1, &store->buffer);
+    invalidateGLStateCache();
     renderCheckError();
     
     // printf("tbo id: %d\n", store->tbo);
@@ -1218,27 +1447,92 @@ void deleteBufferStorage(BufferStorage *store) {
     renderCheckError();
 }
 
-static int lastStorageBufferCount = 0;
-static BufferStorage lastBufferStorage[256] = {};
+/*
+    The instance data of every batch goes in the same three texture buffers, which live as long as the program. Each
+    render group writes all of its instances in one go at the ring's write position and its batches draw from their
+    offset in it (instanceBase in the shaders). When the rest of the ring is too small the buffers are orphaned with
+    glBufferData, so the driver gives us new memory instead of waiting on draws still reading the old, and writing
+    starts again at 0. The three buffers stay in step so one offset works for all of them.
+*/
+#define INSTANCE_RING_START_CAPACITY 16384
+
+typedef struct {
+    BufferStorage transforms; //InstanceTransform, two texels each
+    BufferStorage colors; //V4
+    BufferStorage uvs; //Rect2f, untextured instances leave theirs zeroed
+    int capacity; //in instances
+    int writeAt;
+    
+    int orphanCount; //times the buffers were orphaned, for profiling
+} InstanceRing;
+
+static InstanceRing globalInstanceRing = {};
+
+static inline void orphanBufferStorage(BufferStorage *store, size_t sizeInBytes) {
+    glBindBuffer(GL_TEXTURE_BUFFER, store->tbo);
+    renderCheckError();
+    glBufferData(GL_TEXTURE_BUFFER, sizeInBytes, 0, GL_STREAM_DRAW);
+    renderCheckError();
+}
+
+static inline void writeBufferStorage(BufferStorage *store, size_t offsetInBytes, void *memory, size_t sizeInBytes) {
+    glBindBuffer(GL_TEXTURE_BUFFER, store->tbo);
+    renderCheckError();
+    glBufferSubData(GL_TEXTURE_BUFFER, offsetInBytes, sizeInBytes, memory);
+    renderCheckError();
+}
+
+//NOTE: Returns the instance the first one was written at.
+int writeInstanceRing(InstanceRing *ring, InstanceTransform *transforms, V4 *colors, Rect2f *uvs, int count) {
+    if(!ring->capacity) {
+        ring->capacity = INSTANCE_RING_START_CAPACITY;
+        ring->transforms = createBufferStorage(0, ring->capacity*sizeof(InstanceTransform));
+        ring->colors = createBufferStorage(0, ring->capacity*sizeof(V4));
+        ring->uvs = createBufferStorage(0, ring->capacity*sizeof(Rect2f));
+    }
+    if(ring->writeAt + count > ring->capacity) {
+        while(count > ring->capacity) {
+            ring->capacity *= 2;
+        }
+        orphanBufferStorage(&ring->transforms, ring->capacity*sizeof(InstanceTransform));
+        orphanBufferStorage(&ring->colors, ring->capacity*sizeof(V4));
+        orphanBufferStorage(&ring->uvs, ring->capacity*sizeof(Rect2f));
+        ring->writeAt = 0;
+        ring->orphanCount++;
+    }
+    int result = ring->writeAt;
+    writeBufferStorage(&ring->transforms, result*sizeof(InstanceTransform), transforms, count*sizeof(InstanceTransform));
+    writeBufferStorage(&ring->colors, result*sizeof(V4), colors, count*sizeof(V4));
+    writeBufferStorage(&ring->uvs, result*sizeof(Rect2f), uvs, count*sizeof(Rect2f));
+    ring->writeAt += count;
+    return result;
+}
+
+typedef struct {
+    RenderItem *info; //the first item, the rest only differ in their instance data
+    int instanceStart;
+    int instanceCount;
+} RenderBatch;
+
+//NOTE: The order of items at the same z. Greater than 0 if itemA goes after itemB.
+int cmpRenderItemState(RenderItem *itemA, RenderItem *itemB) {
+    int result = 0;
+    if(itemA->textureHandle != itemB->textureHandle) {
+        result = ((intptr_t)itemA->textureHandle > (intptr_t)itemB->textureHandle) ? 1 : -1;
+    } else if(itemA->bufferHandles != itemB->bufferHandles) {
+        result = ((intptr_t)itemA->bufferHandles > (intptr_t)itemB->bufferHandles) ? 1 : -1;
+    } else if(itemA->program != itemB->program) {
+        result = ((intptr_t)itemA->program > (intptr_t)itemB->program) ? 1 : -1;
+    }
+    return result;
+}
 
 int cmpRenderItemFunc (const void * a, const void * b) {
     RenderItem *itemA = (RenderItem *)a;
     RenderItem *itemB = (RenderItem *)b;
     bool result = true;
     if(itemA->zAt == itemB->zAt) {
-        if(itemA->textureHandle == itemB->textureHandle) {
-            if(itemA->bufferHandles == itemB->bufferHandles) {
-                if(itemA->program == itemB->program) {
-                    result = false;
-                } else {
-                    result = (intptr_t)itemA->program > (intptr_t)itemB->program;
-                }
-            } else {
-                result = (intptr_t)itemA->bufferHandles > (intptr_t)itemB->bufferHandles;                
-            }
-        } else {
-            result = (intptr_t)itemA->textureHandle > (intptr_t)itemB->textureHandle;    
-        }
+        result = (cmpRenderItemState(itemA, itemB) > 0);
     } else {
         result = itemA->zAt > itemB->zAt;
     }
@@ -1246,34 +1540,124 @@ int cmpRenderItemFunc (const void * a, const void * b) {
     return result;
 }
 
-void sortItems(RenderGroup *group) {
-    //this is a bubble sort. I think this is typically a bit slow. 
-    bool sorted = false;
-    int max = (group->items.count - 1);
-    for (int index = 0; index < max; ++index) {
-        RenderItem *infoA = (RenderItem *)getElementFromAlloc_(&group->items, index);
-        RenderItem *infoB = (RenderItem *)getElementFromAlloc_(&group->items, index + 1);
-        assert(infoA && infoB);
-        bool swap = cmpRenderItemFunc(infoA, infoB);
-        if(swap) {
-            RenderItem temp = *infoA;
-            *infoA = *infoB;
-            *infoB = temp;
-            sorted = true;
-        }   
-        if(index == (max - 1) && sorted) {
-            index = 0; 
-            sorted = false;
+/*
+    Items are sorted on a 64 bit key with an LSD radix sort, which keeps items with the same key in the order they
+    were pushed. The high 32 bits are zAt flipped so the bits sort like the floats do. The low 32 bits are the rank of
+    the item's texture, vao & program among the different ones this frame (there are only ever a few), ranked with
+    cmpRenderItemState. So the order is the same as cmpRenderItemFunc.
+*/
+typedef struct {
+    uint64_t key;
+    int itemIndex;
+} RenderSortEntry;
+
+static inline uint32_t getSortableFloatBits(float value) {
+    if(value == 0) {
+        value = 0; //-0 has to sort the same as 0
+    }
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    //NOTE: negative floats sort backwards on their bits, so flip all of them, positive ones only need to go above
+    uint32_t result = (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+    return result;
+}
+
+//NOTE: Returns the items in the order to draw them, on the frame arena.
+RenderItem **sortItems(RenderGroup *group) {
+    int count = group->itemCount;
+    RenderItem *items = group->items;
+    RenderItem **result = pushArray(&globalRenderFrameArena, count, RenderItem *);
+    if(count < 2) {
+        if(count == 1) {
+            result[0] = items;
         }
+        return result;
+    }
+    //NOTE: the radix sort ping pongs between the two
+    RenderSortEntry *entries = pushArray(&globalRenderFrameArena, count, RenderSortEntry);
+    RenderSortEntry *sorted = pushArray(&globalRenderFrameArena, count, RenderSortEntry);
+    //NOTE: an item of each different texture, vao & program, then their ranks. There can't be more than the items.
+    int *states = pushArray(&globalRenderFrameArena, count, int);
+    int *order = pushArray(&globalRenderFrameArena, count, int);
+    
+    //NOTE: find the different states, items in a row mostly have the same one
+    int stateCount = 0;
+    int lastState = -1;
+    for(int itemIndex = 0; itemIndex < count; ++itemIndex) {
+        RenderItem *item = items + itemIndex;
+        int state = lastState;
+        if(state < 0 || cmpRenderItemState(item, items + states[state]) != 0) {
+            state = -1;
+            for(int stateIndex = 0; stateIndex < stateCount; ++stateIndex) {
+                if(cmpRenderItemState(item, items + states[stateIndex]) == 0) {
+                    state = stateIndex;
+                    break;
+                }
+            }
+            if(state < 0) {
+                state = stateCount;
+                states[stateCount++] = itemIndex;
+            }
+        }
+        lastState = state;
+        entries[itemIndex].key = state;
+        entries[itemIndex].itemIndex = itemIndex;
+    }
+    
+    //NOTE: rank the states with an insertion sort, there are only a few of them
+    for(int stateIndex = 0; stateIndex < stateCount; ++stateIndex) {
+        int at = stateIndex;
+        while(at > 0 && cmpRenderItemState(items + states[order[at - 1]], items + states[stateIndex]) > 0) {
+            order[at] = order[at - 1];
+            at--;
+        }
+        order[at] = stateIndex;
+    }
+    //NOTE: the first items of the states aren't needed after this so their ranks go in their place
+    for(int rank = 0; rank < stateCount; ++rank) {
+        states[order[rank]] = rank;
+    }
+    for(int itemIndex = 0; itemIndex < count; ++itemIndex) {
+        int rank = states[entries[itemIndex].key];
+        entries[itemIndex].key = ((uint64_t)getSortableFloatBits(items[itemIndex].zAt) << 32) | (uint32_t)rank;
+    }
+    
+    for(int shift = 0; shift < 64; shift += 8) {
+        int counts[256] = {};
+        for(int entryIndex = 0; entryIndex < count; ++entryIndex) {
+            counts[(entries[entryIndex].key >> shift) & 0xFF]++;
+        }
+        //NOTE: skip the byte if every key has the same one, most of the rank & z bytes are
+        if(counts[(entries[0].key >> shift) & 0xFF] == count) {
+            continue;
+        }
+        int offset = 0;
+        for(int digit = 0; digit < 256; ++digit) {
+            int digitCount = counts[digit];
+            counts[digit] = offset;
+            offset += digitCount;
+        }
+        for(int entryIndex = 0; entryIndex < count; ++entryIndex) {
+            sorted[counts[(entries[entryIndex].key >> shift) & 0xFF]++] = entries[entryIndex];
+        }
+        RenderSortEntry *temp = entries;
+        entries = sorted;
+        sorted = temp;
     }
+    
+    for(int entryIndex = 0; entryIndex < count; ++entryIndex) {
+        result[entryIndex] = items + entries[entryIndex].itemIndex;
+    }
+    return result;
 }
 
 void drawRenderGroup(RenderGroup *group) {
     
-    sortItems(group);
+    RenderItem **sortedItems = sortItems(group);
+    int itemCount = group->itemCount;
     
-    for(int i = 0; i < group->items.count; ++i) {
-        RenderItem *info = (RenderItem *)getElementFromAlloc_(&group->items, i);
+    for(int i = 0; i < itemCount; ++i) {
+        RenderItem *info = sortedItems[i];
         VaoHandle *handle = info->bufferHandles;
         if(handle) {
             if(handle->refresh) {
@@ -1286,102 +1670,65 @@ void drawRenderGroup(RenderGroup *group) {
     
     int drawCallCount = 0;
         
-    // printf("Render Items count: %d\n", group->items.count);
-    // int instanceIndexAt = 0;
-    for(int i = 0; i < group->items.count; ++i) {
-        RenderItem *info = (RenderItem *)getElementFromAlloc_(&group->items, i);
-        glBindFramebuffer(GL_FRAMEBUFFER, info->bufferId);
+    //NOTE: split the items into batches & put all of their instance data together, to go in the ring at once
+    RenderBatch *batches = pushArray(&globalRenderFrameArena, itemCount, RenderBatch);
+    int batchCount = 0;
+    InstanceTransform *transforms = pushArray(&globalRenderFrameArena, itemCount, InstanceTransform);
+    V4 *colors = pushArray(&globalRenderFrameArena, itemCount, V4);
+    Rect2f *uvs = pushArray(&globalRenderFrameArena, itemCount, Rect2f);
+    for(int i = 0; i < itemCount; ) {
+        RenderItem *info = sortedItems[i];
+        RenderBatch *batch = batches + batchCount++;
+        batch->info = info;
+        batch->instanceStart = i;
+        batch->instanceCount = 0;
         
-        if(info->depthTest) {
-            glEnable(GL_DEPTH_TEST);
-        } else {
-            glDisable(GL_DEPTH_TEST);
-        }
-        
-        switch(info->blendFuncType) {
-            case BLEND_FUNC_ZERO_ONE_ZERO_ONE_MINUS_ALPHA: {
-                glBlendFuncSeparate(GL_ZERO, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
-            } break;
-            case BLEND_FUNC_STANDARD: {
-                glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
-            } break;
-            default: {
-                assert(!"case not handled");
-            }
-        }
-        InfiniteAlloc pvms = initInfinteAlloc(float);
-        InfiniteAlloc colors = initInfinteAlloc(float);
-        InfiniteAlloc uvs = initInfinteAlloc(float);
-        
-        addElementInifinteAllocWithCount_(&pvms, info->PVM.val, 16);
-        addElementInifinteAllocWithCount_(&colors, info->color.E, 4);
-        if(info->textureHandle != 0) {
-            addElementInifinteAllocWithCount_(&uvs, info->textureUVs.E, 4);
-        }
-        
-        int instanceCount = 1;
         bool collecting = true;
         while(collecting) {
-            RenderItem *nextItem = getRenderItem(group, i + 1);
-            if(nextItem) {
-
-                if(info->bufferHandles == nextItem->bufferHandles && info->textureHandle == nextItem->textureHandle && info->program == nextItem->program) {
-                    
-                    assert(info->blendFuncType == nextItem->blendFuncType);
-                    assert(info->depthTest == nextItem->depthTest);
-                    //collect data
-                    addElementInifinteAllocWithCount_(&pvms, nextItem->PVM.val, 16);
-                    addElementInifinteAllocWithCount_(&colors, nextItem->color.E, 4);
-                    
-                    if(nextItem->textureHandle) {
-                        addElementInifinteAllocWithCount_(&uvs, nextItem->textureUVs.E, 4);
-                    } else {
-                        assert(uvs.count == 0);
-                    }
-                    
-                    instanceCount++;
-                    releaseInfiniteAlloc(&nextItem->triangleData);
-                    releaseInfiniteAlloc(&nextItem->indicesData);
-                    //
-                    i++;
-                } else {
-                    collecting = false;
-                }
+            RenderItem *nextItem = getRenderItem(sortedItems, itemCount, i);
+            if(nextItem && info->bufferHandles == nextItem->bufferHandles && info->textureHandle == nextItem->textureHandle && info->program == nextItem->program && info->viewProjectionIndex == nextItem->viewProjectionIndex) {
+                assert(info->blendFuncType == nextItem->blendFuncType);
+                assert(info->depthTest == nextItem->depthTest);
+                transforms[i] = nextItem->transform;
+                colors[i] = nextItem->color;
+                uvs[i] = nextItem->textureUVs;
+                batch->instanceCount++;
+                i++;
             } else {
                 collecting = false;
             }
         }
+    }
+    int instanceBase = 0;
+    if(itemCount > 0) {
+        instanceBase = writeInstanceRing(&globalInstanceRing, transforms, colors, uvs, itemCount);
+    }
+    
+    // printf("Render Items count: %d\n", itemCount);
+    for(int batchIndex = 0; batchIndex < batchCount; ++batchIndex) {
+        RenderBatch *batch = batches + batchIndex;
+        RenderItem *info = batch->info;
+        setGLFrameBuffer(info->bufferId);
+        setGLDepthTest(info->depthTest);
+        setGLBlendFunc(info->blendFuncType);
         
-        BufferStorage pvmStore = createBufferStorage(&pvms);
-        BufferStorage colorStore = createBufferStorage(&colors);
-        BufferStorage uvStore = {};
         u32 uvId = 0;
-        if(uvs.count > 0) {
-            uvStore = createBufferStorage(&uvs);
-            uvId = uvStore.buffer;
+        if(info->textureHandle != 0) {
+            uvId = globalInstanceRing.uvs.buffer;
         }
         
-        drawVao(info->bufferHandles, (Vertex *)info->triangleData.memory, info->triCount, (unsigned int *)info->indicesData.memory, info->indexCount, info->program, info->type, info->textureHandle, pvmStore.buffer, colorStore.buffer, uvId, info->color, DRAWCALL_INSTANCED, instanceCount);
+        RenderGeometry *geometry = info->geometry;
+        drawVao(info->bufferHandles, geometry->triangleData, geometry->triCount, geometry->indicesData, geometry->indexCount, info->program, info->type, info->textureHandle, &group->viewProjections[info->viewProjectionIndex], instanceBase + batch->instanceStart, globalInstanceRing.transforms.buffer, globalInstanceRing.colors.buffer, uvId, info->color, DRAWCALL_INSTANCED, batch->instanceCount);
         drawCallCount++;
-        
-        assert(lastStorageBufferCount < arrayCount(lastBufferStorage));
-        lastBufferStorage[lastStorageBufferCount++] = pvmStore;
-        assert(lastStorageBufferCount < arrayCount(lastBufferStorage));
-        lastBufferStorage[lastStorageBufferCount++] = colorStore;
-        if(uvs.count > 0) {
-            assert(lastStorageBufferCount < arrayCount(lastBufferStorage));
-            lastBufferStorage[lastStorageBufferCount++] = uvStore;
-        }
-        
-        releaseInfiniteAlloc(&info->triangleData);
-        releaseInfiniteAlloc(&info->indicesData);
-        releaseInfiniteAlloc(&pvms);
-        releaseInfiniteAlloc(&colors);
-        
-        
-        
+        globalRenderStats.drawCalls++;
     }
-    releaseInfiniteAlloc(&group->items);
+    //NOTE: the memory is on the frame arena, it goes in easyOS_beginFrame
+    group->items = 0;
+    group->itemCount = 0;
+    group->itemCapacity = 0;
+    group->viewProjections = 0;
+    group->viewProjectionCount = 0;
+    group->viewProjectionCapacity = 0;
 #if PRINT_NUMBER_DRAW_CALLS
     printf("NUMBER OF DRAW CALLS: %d\n", drawCallCount);
 #endif
@@ -1412,6 +1759,7 @@ Texture createTextureOnGPU(unsigned char *image, int w, int h, int comp) {
         }
         
         glBindTexture(GL_TEXTURE_2D, 0);
+        invalidateGLStateCache();
     } 
     
     return result;
@@ -0,0 +1,179 @@
+/*
+    Runs lots of independent headless games across every core, for balancing the levels. Each game gets its own seed,
+    LevelType and blockCount and is played by the HeadlessBot.
+
+    Scheduling: every worker starts with an even slice of the games. A worker's games left are one [begin, end) range
+    packed into a 64 bit word, so the owner takes the next game and other workers steal the back half with a single
+    compare and swap. A worker that runs out steals from the others, and stops once there is nothing left to steal.
+
+    Every worker has its own arena, a game only lives until its result is added to the totals with atomic adds.
+*/
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#define MAX_BATCH_THREADS 64
+#define BATCH_LEVEL_COUNT (LEVEL_4 + 1)
+
+typedef struct {
+    std::atomic<int> gameCount;
+    std::atomic<long long> linesCleared;
+    std::atomic<long long> experiencePoints;
+    std::atomic<long long> explosivesHit;
+    std::atomic<long long> levelsFailed;
+} BatchTotals;
+
+typedef struct {
+    std::atomic<uint64_t> range; //low 32 bits is the next game, high 32 bits is one past the last game
+    char padding[64 - sizeof(std::atomic<uint64_t>)]; //keep each worker's range on its own cache line
+} BatchQueue;
+
+typedef struct {
+    int gameCount;
+    int framesPerGame;
+    unsigned int seed;
+
+    int threadCount;
+    BatchQueue queues[MAX_BATCH_THREADS];
+
+    BatchTotals levelTotals[BATCH_LEVEL_COUNT];
+    std::atomic<long long> gamesStolen;
+} BatchScheduler;
+
+static inline uint64_t packBatchRange(uint32_t begin, uint32_t end) {
+    uint64_t result = ((uint64_t)end << 32) | begin;
+    return result;
+}
+
+static inline bool popBatchGame(BatchQueue *queue, int *gameIndex) {
+    uint64_t range = queue->range.load();
+    for(;;) {
+        uint32_t begin = (uint32_t)range;
+        uint32_t end = (uint32_t)(range >> 32);
+        if(begin >= end) {
+            return false;
+        }
+        if(queue->range.compare_exchange_weak(range, packBatchRange(begin + 1, end))) {
+            *gameIndex = begin;
+            return true;
+        }
+    }
+}
+
+//NOTE: Takes the back half of another worker's games. Only called when our own range is empty.
+bool stealBatchGames(BatchScheduler *scheduler, int workerIndex, RandomSeries *random) {
+    int startVictim = randomIndex(random, scheduler->threadCount);
+    for(int victimOffset = 0; victimOffset < scheduler->threadCount; ++victimOffset) {
+        int victimIndex = (startVictim + victimOffset) % scheduler->threadCount;
+        if(victimIndex == workerIndex) {
+            continue;
+        }
+        BatchQueue *victim = &scheduler->queues[victimIndex];
+        uint64_t range = victim->range.load();
+        for(;;) {
+            uint32_t begin = (uint32_t)range;
+            uint32_t end = (uint32_t)(range >> 32);
+            if(begin >= end) {
+                break;
+            }
+            uint32_t stealCount = (end - begin + 1) / 2;
+            uint32_t newEnd = end - stealCount;
+            if(victim->range.compare_exchange_weak(range, packBatchRange(begin, newEnd))) {
+                scheduler->queues[workerIndex].range.store(packBatchRange(newEnd, end));
+                scheduler->gamesStolen += stealCount;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void runBatchGame(BatchScheduler *scheduler, Arena *arena, int gameIndex) {
+    MemoryArenaMark memMark = takeMemoryMark(arena);
+
+    unsigned int seed = scheduler->seed + gameIndex;
+    LevelType levelType = (LevelType)(gameIndex % BATCH_LEVEL_COUNT);
+    int blockCount = 4 + (gameIndex / BATCH_LEVEL_COUNT) % 8;
+
+    GameState game = {};
+    initGame(&game, arena, BOARD_WIDTH, BOARD_HEIGHT, levelType, blockCount, initRandomSeries(seed));
+    HeadlessBot bot = {};
+    bot.random = initRandomSeries(seed, 1);
+    runHeadlessBotGame(&game, &bot, scheduler->framesPerGame, HEADLESS_DT, 0);
+
+    BatchTotals *totals = &scheduler->levelTotals[levelType];
+    totals->gameCount += 1;
+    totals->linesCleared += game.stats.linesCleared;
+    totals->experiencePoints += game.experiencePoints;
+    totals->explosivesHit += game.stats.explosivesHit;
+    totals->levelsFailed += game.stats.levelsFailed;
+
+    releaseMemoryMark(&memMark);
+}
+
+void runBatchWorker(BatchScheduler *scheduler, int workerIndex) {
+    Arena arena = createArena(Megabytes(4));
+    RandomSeries stealRandom = initRandomSeries(workerIndex, 2);
+
+    for(;;) {
+        int gameIndex = 0;
+        if(popBatchGame(&scheduler->queues[workerIndex], &gameIndex)) {
+            runBatchGame(scheduler, &arena, gameIndex);
+        } else if(!stealBatchGames(scheduler, workerIndex, &stealRandom)) {
+            break;
+        }
+    }
+    free(arena.memory);
+}
+
+//NOTE: threadCount of 0 uses every core.
+void runBatch(int gameCount, int framesPerGame, int threadCount, unsigned int seed) {
+    if(threadCount <= 0) {
+        threadCount = (int)std::thread::hardware_concurrency();
+    }
+    threadCount = (int)clamp(1, threadCount, MAX_BATCH_THREADS);
+
+    BatchScheduler *scheduler = new BatchScheduler();
+    scheduler->gameCount = gameCount;
+    scheduler->framesPerGame = framesPerGame;
+    scheduler->seed = seed;
+    scheduler->threadCount = threadCount;
+    for(int workerIndex = 0; workerIndex < threadCount; ++workerIndex) {
+        uint32_t begin = (uint32_t)(((long long)gameCount*workerIndex) / threadCount);
+        uint32_t end = (uint32_t)(((long long)gameCount*(workerIndex + 1)) / threadCount);
+        scheduler->queues[workerIndex].range.store(packBatchRange(begin, end));
+    }
+
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    //NOTE: this thread is worker 0
+    std::thread threads[MAX_BATCH_THREADS];
+    for(int workerIndex = 1; workerIndex < threadCount; ++workerIndex) {
+        threads[workerIndex] = std::thread(runBatchWorker, scheduler, workerIndex);
+    }
+    runBatchWorker(scheduler, 0);
+    for(int workerIndex = 1; workerIndex < threadCount; ++workerIndex) {
+        threads[workerIndex].join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    int gamesRun = 0;
+    printf("level  games  lines/game  xp/game  explosives/game  fails/game\n");
+    for(int levelIndex = 0; levelIndex < BATCH_LEVEL_COUNT; ++levelIndex) {
+        BatchTotals *totals = &scheduler->levelTotals[levelIndex];
+        int levelGames = totals->gameCount;
+        gamesRun += levelGames;
+        if(levelGames > 0) {
+            printf("%5d  %5d  %10.2f  %7.1f  %15.2f  %10.2f\n", levelIndex, levelGames,
+                   (double)totals->linesCleared / levelGames, (double)totals->experiencePoints / levelGames,
+                   (double)totals->explosivesHit / levelGames, (double)totals->levelsFailed / levelGames);
+        }
+    }
+    assert(gamesRun == gameCount);
+
+    printf("%d games x %d frames on %d threads (%lld games stolen): %.2fs, %.1f games/s\n", gamesRun, framesPerGame,
+           threadCount, (long long)scheduler->gamesStolen, seconds, gamesRun / seconds);
+
+    delete scheduler;
+}
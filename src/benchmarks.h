@@ -0,0 +1,763 @@
+/*
+    Micro benchmarks for the game logic, run with: headless bench
+*/
+
+static inline double getBenchMilliseconds(clock_t startTime) {
+    double result = 1000.0*(double)(clock() - startTime) / CLOCKS_PER_SEC;
+    return result;
+}
+
+//NOTE: An empty LEVEL_0 game on arena, what every bench starts from. Take the bench's memory mark first.
+void initBenchGame(GameState *game, Arena *arena, int boardWidth, int boardHeight) {
+    initGame(game, arena, boardWidth, boardHeight, LEVEL_0, 0, initRandomSeries(0));
+}
+
+//NOTE: A board full of random blocks, the same as what a long game on a big board ends up like.
+void fillBenchBoard(GameState *game) {
+    for(int boardY = 0; boardY < game->boardHeight; ++boardY) {
+        for(int boardX = 0; boardX < game->boardWidth; ++boardX) {
+            BoardState state = (BoardState)randomIndex(&game->random, BOARD_INVALID);
+            setBoardState(game, v2(boardX, boardY), state, BOARD_VAL_OLD);
+        }
+    }
+}
+
+/*
+    Counts the filled cells of the board. Compares the old layout (an array of BoardValue, ~36 bytes a cell) against
+    the one byte state array the board is now stored as.
+*/
+void benchBoardScan(Arena *arena, int boardWidth, int boardHeight, int scanCount) {
+    MemoryArenaMark memMark = takeMemoryMark(arena);
+
+    GameState game = {};
+    initBenchGame(&game, arena, boardWidth, boardHeight);
+    fillBenchBoard(&game);
+
+    int cellCount = boardWidth*boardHeight;
+    BoardValue *boardValues = pushArray(arena, cellCount, BoardValue);
+    for(int boardIndex = 0; boardIndex < cellCount; ++boardIndex) {
+        boardValues[boardIndex] = getBoardValue(&game, v2(boardIndex % boardWidth, boardIndex / boardWidth));
+    }
+
+    volatile int filledCount = 0;
+
+    clock_t startTime = clock();
+    for(int scanIndex = 0; scanIndex < scanCount; ++scanIndex) {
+        int count = 0;
+        for(int boardIndex = 0; boardIndex < cellCount; ++boardIndex) {
+            BoardState state = boardValues[boardIndex].state;
+            count += (state == BOARD_STATIC || state == BOARD_EXPLOSIVE);
+        }
+        filledCount = count;
+    }
+    double valueMilliseconds = getBenchMilliseconds(startTime);
+
+    startTime = clock();
+    for(int scanIndex = 0; scanIndex < scanCount; ++scanIndex) {
+        int count = 0;
+        for(int boardIndex = 0; boardIndex < cellCount; ++boardIndex) {
+            u8 state = game.board.states[boardIndex];
+            count += (state == BOARD_STATIC || state == BOARD_EXPLOSIVE);
+        }
+        filledCount = count;
+    }
+    double stateMilliseconds = getBenchMilliseconds(startTime);
+
+    printf("board scan %dx%d: BoardValue array %.3fms, state bytes %.3fms per scan (%.1fx)\n", boardWidth, boardHeight,
+           valueMilliseconds / scanCount, stateMilliseconds / scanCount, valueMilliseconds / max(stateMilliseconds, 0.001f));
+
+    releaseMemoryMark(&memMark);
+}
+
+/*
+    The line clear check after one block changes. Compares scanning the masks of every row against updateBoardWinState,
+    which only looks at the rows that changed.
+*/
+void benchWinCheck(Arena *arena, int boardWidth, int boardHeight, int frameCount) {
+    MemoryArenaMark memMark = takeMemoryMark(arena);
+
+    GameState game = {};
+    initBenchGame(&game, arena, boardWidth, boardHeight);
+    fillBenchBoard(&game);
+    updateBoardWinState(&game);
+
+    volatile int fullCount = 0;
+
+    clock_t startTime = clock();
+    for(int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+        int count = 0;
+        for(int boardY = 0; boardY < boardHeight; ++boardY) {
+            count += isMaskRowFull(&game.masks, boardY);
+        }
+        fullCount = count;
+    }
+    double scanMilliseconds = getBenchMilliseconds(startTime);
+
+    startTime = clock();
+    for(int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+        V2 pos = v2(randomIndex(&game.random, boardWidth), randomIndex(&game.random, boardHeight));
+        BoardState state = (getBoardState(&game, pos) == BOARD_STATIC) ? BOARD_NULL : BOARD_STATIC;
+        setBoardState(&game, pos, state, BOARD_VAL_NULL);
+        updateBoardWinState(&game);
+    }
+    double dirtyMilliseconds = getBenchMilliseconds(startTime);
+    fullCount = game.experiencePoints;
+
+    printf("win check %dx%d: every row %.4fms, dirty rows %.4fms per frame (%.1fx)\n", boardWidth, boardHeight,
+           scanMilliseconds / frameCount, dirtyMilliseconds / frameCount, scanMilliseconds / max(dirtyMilliseconds, 0.001f));
+
+    releaseMemoryMark(&memMark);
+}
+
+/*
+    The board flood fill shapeStillConnected used before ShapeGraph, kept to time against and to check the answers match.
+*/
+typedef struct VisitedQueue VisitedQueue;
+typedef struct VisitedQueue {
+    V2 pos;
+    VisitedQueue *next;
+    VisitedQueue *prev;
+} VisitedQueue;
+
+void addToQueryList(GameState *game, VisitedQueue *sentinel, V2 pos, Arena *arena, bool *boardArray, int boardWidth) {
+    bool *visitedPtr = &boardArray[(((int)pos.y)*boardWidth) + (int)pos.x];
+    bool visited = *visitedPtr;
+
+    if(!visited && getBoardState(game, pos) == BOARD_SHAPE) {
+        *visitedPtr = true;
+        VisitedQueue *queue = pushStruct(arena, VisitedQueue);
+        queue->pos = pos;
+
+        //add to the search queue
+        assert(sentinel->prev->next == sentinel);
+        queue->prev = sentinel->prev;
+        queue->next = sentinel;
+        sentinel->prev->next = queue;
+        sentinel->prev = queue;
+    }
+}
+typedef struct {
+    int count;
+    V2 poses[MAX_SHAPE_COUNT];
+} FloodFillIslandInfo;
+
+FloodFillIslandInfo getShapeIslandCountFloodFill(FitrisShape *shape, V2 startPos, GameState *game) {
+    FloodFillIslandInfo info = {};
+    //NOTE: This is since shape can be blown apart we want to still be able to move a block on their
+    //own island. So the count isn't the shapeCount but only a portion in this count. So we first search
+    //how big the island is and match against that.
+
+    MemoryArenaMark memMark = takeMemoryMark(game->arena);
+    bool *boardArray = pushArray(game->arena, game->boardWidth*game->boardHeight, bool);
+
+    VisitedQueue sentinel = {};
+    sentinel.next = sentinel.prev = &sentinel;
+
+#define ADD_TO_QUERY_LIST(toMoveVec, thePos) addToQueryList(game, &sentinel, v2_plus(thePos, toMoveVec), game->arena, boardArray, game->boardWidth);
+    ADD_TO_QUERY_LIST(v2(0, 0), startPos);
+
+    VisitedQueue *queryAt = sentinel.next;
+    assert(queryAt != &sentinel);
+    while(queryAt != &sentinel) {
+        V2 pos = queryAt->pos;
+
+        assert(info.count < arrayCount(info.poses));
+        info.poses[info.count++] = pos;
+
+        ADD_TO_QUERY_LIST(v2(1, 0), pos);
+        ADD_TO_QUERY_LIST(v2(-1, 0), pos);
+        ADD_TO_QUERY_LIST(v2(0, 1), pos);
+        ADD_TO_QUERY_LIST(v2(0, -1), pos);
+#if CAN_ALTER_SHAPE_DIAGONAL
+        ADD_TO_QUERY_LIST(v2(1, 1), pos);
+        ADD_TO_QUERY_LIST(v2(-1, 1), pos);
+        ADD_TO_QUERY_LIST(v2(-1, -1), pos);
+        ADD_TO_QUERY_LIST(v2(1, -1), pos);
+#endif
+        queryAt = queryAt->next;
+    }
+    releaseMemoryMark(&memMark);
+    assert(info.count <= shape->count);
+
+    return info;
+}
+
+bool shapeStillConnectedFloodFill(FitrisShape *shape, int currentHotIndex, V2 boardPosAt, GameState *game) {
+    bool result = true;
+
+    for(int i = 0; i < shape->count; ++i) {
+        V2 pos = shape->coords[i];
+        if(boardPosAt.x == pos.x && boardPosAt.y == pos.y) {
+            result = false;
+            break;
+        }
+
+        BoardState state = getBoardState(game, boardPosAt);
+        if(state != BOARD_NULL) {
+            result = false;
+            break;
+        }
+    }
+    if(result) {
+        V2 oldPos = shape->coords[currentHotIndex];
+
+        assert(getBoardState(game, oldPos) == BOARD_SHAPE);
+
+        FloodFillIslandInfo mainFloodFillIslandInfo = getShapeIslandCountFloodFill(shape, oldPos, game);
+        assert(mainFloodFillIslandInfo.count >= 1);
+        if(mainFloodFillIslandInfo.count <= 1) {
+            result = false;
+        } else {
+            V2 idPos = mainFloodFillIslandInfo.poses[1]; //won't be that starting pos.
+            //temporaialy set the board state to where the shape was to be null, so this can act as a bridge in the flood fill
+            setBoardStateInPlace(game, oldPos, BOARD_NULL);
+
+            assert(getBoardState(game, boardPosAt) == BOARD_NULL);
+            setBoardStateInPlace(game, boardPosAt, BOARD_SHAPE);
+            ////
+
+            FloodFillIslandInfo islandInfo = getShapeIslandCountFloodFill(shape, boardPosAt, game);
+
+            bool found = false;
+            for(int index = 0; index < islandInfo.count; ++index) {
+                V2 srchPos = islandInfo.poses[index];
+                if(srchPos.x == idPos.x && srchPos.y == idPos.y) {
+                    found = true;
+                    break;
+                }
+            }
+
+            if(islandInfo.count != mainFloodFillIslandInfo.count || !found) {
+                result = false;
+            }
+            //set the state back to being a shape.
+            setBoardStateInPlace(game, oldPos, BOARD_SHAPE);
+            setBoardStateInPlace(game, boardPosAt, BOARD_NULL);
+        }
+    }
+
+    return result;
+}
+
+//NOTE: A snake of blocks from the middle of the board, so some moves keep it connected and some split it.
+void createBenchShape(GameState *game, FitrisShape *shape, int blockCount) {
+    shape->count = 0;
+    V2 pos = v2(game->boardWidth / 2, game->boardHeight / 4);
+    V2 moves[] = {v2(0, 1), v2(1, 0), v2(0, 1), v2(-1, 0)};
+    for(int i = 0; i < blockCount; ++i) {
+        shape->coords[shape->count++] = pos;
+        setBoardState(game, pos, BOARD_SHAPE, BOARD_VAL_TRANSIENT);
+        pos = v2_plus(pos, moves[i % arrayCount(moves)]);
+    }
+}
+
+/*
+    shapeStillConnected for every block of the shape against every cell next to it, the work done while dragging.
+    Compares the board flood fill against ShapeGraph.
+*/
+void benchShapeConnected(Arena *arena, int boardWidth, int boardHeight, int repeatCount) {
+    MemoryArenaMark memMark = takeMemoryMark(arena);
+
+    GameState game = {};
+    initBenchGame(&game, arena, boardWidth, boardHeight);
+    FitrisShape shape = {};
+    createBenchShape(&game, &shape, MAX_SHAPE_COUNT);
+
+    V2 offsets[] = {v2(1, 0), v2(-1, 0), v2(0, 1), v2(0, -1)};
+    int connectedCount = 0;
+    for(int hotIndex = 0; hotIndex < shape.count; ++hotIndex) {
+        for(int offsetIndex = 0; offsetIndex < arrayCount(offsets); ++offsetIndex) {
+            V2 boardPosAt = v2_plus(shape.coords[hotIndex], offsets[offsetIndex]);
+            bool floodFillResult = shapeStillConnectedFloodFill(&shape, hotIndex, boardPosAt, &game);
+            bool graphResult = shapeStillConnected(&shape, hotIndex, boardPosAt, &game);
+            assert(floodFillResult == graphResult);
+            connectedCount += graphResult;
+        }
+    }
+
+    size_t arenaSizeBefore = arena->currentSize;
+    volatile int resultCount = 0;
+
+    clock_t startTime = clock();
+    for(int repeatIndex = 0; repeatIndex < repeatCount; ++repeatIndex) {
+        int count = 0;
+        for(int hotIndex = 0; hotIndex < shape.count; ++hotIndex) {
+            for(int offsetIndex = 0; offsetIndex < arrayCount(offsets); ++offsetIndex) {
+                V2 boardPosAt = v2_plus(shape.coords[hotIndex], offsets[offsetIndex]);
+                count += shapeStillConnectedFloodFill(&shape, hotIndex, boardPosAt, &game);
+            }
+        }
+        resultCount = count;
+    }
+    double floodFillMilliseconds = getBenchMilliseconds(startTime);
+
+    startTime = clock();
+    for(int repeatIndex = 0; repeatIndex < repeatCount; ++repeatIndex) {
+        int count = 0;
+        for(int hotIndex = 0; hotIndex < shape.count; ++hotIndex) {
+            for(int offsetIndex = 0; offsetIndex < arrayCount(offsets); ++offsetIndex) {
+                V2 boardPosAt = v2_plus(shape.coords[hotIndex], offsets[offsetIndex]);
+                count += shapeStillConnected(&shape, hotIndex, boardPosAt, &game);
+            }
+        }
+        resultCount = count;
+    }
+    double graphMilliseconds = getBenchMilliseconds(startTime);
+    assert(arena->currentSize == arenaSizeBefore);
+
+    int checkCount = repeatCount*shape.count*arrayCount(offsets);
+    printf("shape connected %dx%d (%d of %d moves ok): flood fill %.5fms, shape graph %.5fms per check (%.1fx)\n",
+           boardWidth, boardHeight, connectedCount, shape.count*(int)arrayCount(offsets),
+           floodFillMilliseconds / checkCount, graphMilliseconds / checkCount, floodFillMilliseconds / max(graphMilliseconds, 0.001f));
+
+    releaseMemoryMark(&memMark);
+}
+
+/*
+    A held block over a run of frames with the cursor moving around the shape. Compares calling shapeStillConnected
+    every frame against building the DragTargetMap once and looking the cursor up in it.
+*/
+void benchDragTargets(Arena *arena, int boardWidth, int boardHeight, int frameCount) {
+    MemoryArenaMark memMark = takeMemoryMark(arena);
+
+    GameState game = {};
+    initBenchGame(&game, arena, boardWidth, boardHeight);
+    FitrisShape shape = {};
+    createBenchShape(&game, &shape, MAX_SHAPE_COUNT);
+
+    //NOTE: the cursor goes over every cell near the shape
+    int areaMinX = (int)shape.coords[0].x - 2;
+    int areaMinY = (int)shape.coords[0].y - 2;
+    int areaWidth = 6;
+    int areaHeight = MAX_SHAPE_COUNT / 2 + 4;
+
+    for(int hotIndex = 0; hotIndex < shape.count; ++hotIndex) {
+        game.currentHotIndex = hotIndex;
+        updateDragTargetMap(&game, &shape);
+        for(int areaIndex = 0; areaIndex < areaWidth*areaHeight; ++areaIndex) {
+            V2 boardPosAt = v2(areaMinX + (areaIndex % areaWidth), areaMinY + (areaIndex / areaWidth));
+            assert(isDragTarget(&game, boardPosAt) == shapeStillConnected(&shape, hotIndex, boardPosAt, &game));
+        }
+    }
+
+    volatile int resultCount = 0;
+
+    clock_t startTime = clock();
+    for(int hotIndex = 0; hotIndex < shape.count; ++hotIndex) {
+        int count = 0;
+        for(int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+            int areaIndex = frameIndex % (areaWidth*areaHeight);
+            V2 boardPosAt = v2(areaMinX + (areaIndex % areaWidth), areaMinY + (areaIndex / areaWidth));
+            count += shapeStillConnected(&shape, hotIndex, boardPosAt, &game);
+        }
+        resultCount = count;
+    }
+    double connectedMilliseconds = getBenchMilliseconds(startTime);
+
+    startTime = clock();
+    for(int hotIndex = 0; hotIndex < shape.count; ++hotIndex) {
+        game.currentHotIndex = hotIndex;
+        int count = 0;
+        for(int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+            int areaIndex = frameIndex % (areaWidth*areaHeight);
+            V2 boardPosAt = v2(areaMinX + (areaIndex % areaWidth), areaMinY + (areaIndex / areaWidth));
+            updateDragTargetMap(&game, &shape);
+            count += isDragTarget(&game, boardPosAt);
+        }
+        resultCount = count;
+    }
+    double mapMilliseconds = getBenchMilliseconds(startTime);
+
+    //NOTE: what a drag start or a board change costs
+    startTime = clock();
+    for(int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+        game.dragTargets.valid = false;
+        game.currentHotIndex = frameIndex % shape.count;
+        updateDragTargetMap(&game, &shape);
+    }
+    double buildMilliseconds = getBenchMilliseconds(startTime);
+
+    int dragFrameCount = shape.count*frameCount;
+    printf("drag targets %dx%d: shapeStillConnected %.5fms, map lookup %.5fms per frame (%.1fx), map build %.5fms\n",
+           boardWidth, boardHeight, connectedMilliseconds / dragFrameCount, mapMilliseconds / dragFrameCount,
+           connectedMilliseconds / max(mapMilliseconds, 0.001f), buildMilliseconds / frameCount);
+
+    releaseMemoryMark(&memMark);
+}
+
+/*
+    A frame of fade updates with a few cells fading, like after a shape lands. Compares checking the timer of every
+    cell against updateBoardFades going through the fading lists of the chunks, with the whole board on screen.
+*/
+void benchBoardFades(Arena *arena, int boardWidth, int boardHeight, int fadeCount, int frameCount) {
+    MemoryArenaMark memMark = takeMemoryMark(arena);
+
+    GameState game = {};
+    initBenchGame(&game, arena, boardWidth, boardHeight);
+    int cellCount = boardWidth*boardHeight;
+    BoardArrays *board = &game.board;
+    float dt = FADE_TIMER_INTERVAL / 4;
+    BoardCellRect allCells = {0, 0, boardWidth - 1, boardHeight - 1};
+
+    //NOTE: the old layout, a fade timer & previous state for every cell
+    Timer *fadeTimers = pushArray(arena, cellCount, Timer);
+    u8 *prevStates = pushArray(arena, cellCount, u8);
+    for(int boardIndex = 0; boardIndex < cellCount; ++boardIndex) {
+        fadeTimers[boardIndex].value = -1;
+    }
+
+    clock_t startTime = clock();
+    for(int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+        for(int fadeIndex = 0; fadeIndex < fadeCount; ++fadeIndex) {
+            int boardIndex = randomIndex(&game.random, cellCount);
+            fadeTimers[boardIndex] = initTimer(FADE_TIMER_INTERVAL);
+        }
+        for(int boardIndex = 0; boardIndex < cellCount; ++boardIndex) {
+            Timer *fadeTimer = &fadeTimers[boardIndex];
+            if(isOn(fadeTimer)) {
+                TimerReturnInfo timeInfo = updateTimer(fadeTimer, dt);
+                if(timeInfo.finished) {
+                    prevStates[boardIndex] = board->states[boardIndex];
+                }
+            }
+        }
+    }
+    double everyCellMilliseconds = getBenchMilliseconds(startTime);
+
+    startTime = clock();
+    for(int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+        for(int fadeIndex = 0; fadeIndex < fadeCount; ++fadeIndex) {
+            int boardIndex = randomIndex(&game.random, cellCount);
+            setBoardState(&game, v2(boardIndex % boardWidth, boardIndex / boardWidth), BOARD_NULL, BOARD_VAL_NULL);
+        }
+        updateBoardFades(&game, dt, allCells);
+    }
+    double activeListMilliseconds = getBenchMilliseconds(startTime);
+
+    printf("fades %dx%d (%d new a frame): every cell %.4fms, fading list %.4fms per frame (%.1fx)\n", boardWidth, boardHeight, fadeCount,
+           everyCellMilliseconds / frameCount, activeListMilliseconds / frameCount, everyCellMilliseconds / max(activeListMilliseconds, 0.001f));
+
+    releaseMemoryMark(&memMark);
+}
+
+/*
+    A snapshot taken after every few cells change, then going back a few snapshots, like undo while playing. Compares
+    copying the whole board's states & types each time against the copy on write UndoRing. Checks every restore
+    against the full copy. A small board is a single band in the ring, so there the ring copies the whole board too
+    and only pays for its bookkeeping (the shape, timers & refcounts) on top.
+*/
+void benchSnapshots(Arena *arena, int boardWidth, int boardHeight, int changesPerSnapshot, int snapshotCount) {
+    MemoryArenaMark memMark = takeMemoryMark(arena);
+
+    GameState game = {};
+    initBenchGame(&game, arena, boardWidth, boardHeight);
+    fillBenchBoard(&game);
+    int cellCount = boardWidth*boardHeight;
+
+    int capacity = 8;
+    int restoreAge = 3;
+    u8 *fullCopies = pushArray(arena, (size_t)capacity*2*cellCount, u8);
+    u8 *restoredBoard = pushArray(arena, 2*cellCount, u8);
+
+    RandomSeries changeRandom = initRandomSeries(1);
+    clock_t startTime = clock();
+    for(int snapshotIndex = 0; snapshotIndex < snapshotCount; ++snapshotIndex) {
+        for(int changeIndex = 0; changeIndex < changesPerSnapshot; ++changeIndex) {
+            int boardIndex = randomIndex(&changeRandom, cellCount);
+            setBoardState(&game, v2(boardIndex % boardWidth, boardIndex / boardWidth), (BoardState)randomIndex(&changeRandom, BOARD_INVALID), BOARD_VAL_OLD);
+        }
+        u8 *copy = fullCopies + (size_t)(snapshotIndex % capacity)*2*cellCount;
+        memcpy(copy, game.board.states, cellCount);
+        memcpy(copy + cellCount, game.board.types, cellCount);
+        if(snapshotIndex % 16 == 15) {
+            //NOTE: into a scratch board, the live one would need its masks worked out again too
+            u8 *oldCopy = fullCopies + (size_t)((snapshotIndex - restoreAge) % capacity)*2*cellCount;
+            memcpy(restoredBoard, oldCopy, 2*cellCount);
+        }
+    }
+    double fullCopyMilliseconds = getBenchMilliseconds(startTime);
+
+    //NOTE: the second pass isn't timed, it checks every restore against the full copies
+    UndoRing ring = {};
+    initUndoRing(&ring, boardWidth, boardHeight, capacity);
+    double ringMilliseconds = 0;
+    for(int pass = 0; pass < 2; ++pass) {
+        bool checking = (pass == 1);
+        initBoard(arena, &game, boardWidth, boardHeight, LEVEL_0, 0, false);
+        fillBenchBoard(&game);
+        clearUndoRing(&ring);
+        changeRandom = initRandomSeries(1);
+
+        startTime = clock();
+        for(int snapshotIndex = 0; snapshotIndex < snapshotCount; ++snapshotIndex) {
+            for(int changeIndex = 0; changeIndex < changesPerSnapshot; ++changeIndex) {
+                int boardIndex = randomIndex(&changeRandom, cellCount);
+                setBoardState(&game, v2(boardIndex % boardWidth, boardIndex / boardWidth), (BoardState)randomIndex(&changeRandom, BOARD_INVALID), BOARD_VAL_OLD);
+            }
+            pushBoardSnapshot(&ring, &game);
+            if(checking) {
+                u8 *copy = fullCopies + (size_t)(snapshotIndex % capacity)*2*cellCount;
+                memcpy(copy, game.board.states, cellCount);
+                memcpy(copy + cellCount, game.board.types, cellCount);
+            }
+            if(snapshotIndex % 16 == 15) {
+                restoreBoardSnapshot(&ring, &game, restoreAge);
+                if(checking) {
+                    u8 *oldCopy = fullCopies + (size_t)((snapshotIndex - restoreAge) % capacity)*2*cellCount;
+                    assert(memcmp(game.board.states, oldCopy, cellCount) == 0 && memcmp(game.board.types, oldCopy + cellCount, cellCount) == 0);
+                }
+            }
+        }
+        if(!checking) {
+            ringMilliseconds = getBenchMilliseconds(startTime);
+        }
+    }
+    assert(game.zobristHash == computeZobristHash(&game));
+    freeUndoRing(&ring);
+
+    printf("snapshots %dx%d (%d changes each): full copy %.5fms, undo ring %.5fms per snapshot (%.1fx)\n", boardWidth, boardHeight,
+           changesPerSnapshot, fullCopyMilliseconds / snapshotCount, ringMilliseconds / snapshotCount, fullCopyMilliseconds / max(ringMilliseconds, 0.001f));
+
+    releaseMemoryMark(&memMark);
+}
+
+/*
+    A huge board with play only around where the camera is, like an event board. Shows what the board costs to make
+    and restart against the old layout of a color, fade timer & previous state per cell, and what a frame of drawing
+    the screen's worth of it visits.
+*/
+void benchHugeBoard(Arena *arena, int boardWidth, int boardHeight, int frameCount) {
+    MemoryArenaMark memMark = takeMemoryMark(arena);
+
+    GameState game = {};
+    unsigned int sizeAtStart = arena->currentSize;
+    clock_t startTime = clock();
+    initBenchGame(&game, arena, boardWidth, boardHeight);
+    double initMilliseconds = getBenchMilliseconds(startTime);
+    size_t cellCount = (size_t)boardWidth*boardHeight;
+    size_t oldBytes = cellCount*(3*sizeof(u8) + sizeof(V4) + sizeof(Timer) + 2*sizeof(int));
+
+    //NOTE: play around the middle of the board, and in a corner far off screen that is still fading
+    BoardCamera camera = initBoardCamera(boardWidth, boardHeight);
+    for(int changeIndex = 0; changeIndex < 2000; ++changeIndex) {
+        V2 pos = v2(camera.pos.x - 32 + randomIndex(&game.random, 64), camera.pos.y - 32 + randomIndex(&game.random, 64));
+        setBoardState(&game, pos, BOARD_STATIC, BOARD_VAL_OLD);
+    }
+    for(int changeIndex = 0; changeIndex < 2000; ++changeIndex) {
+        V2 pos = v2(randomIndex(&game.random, 64), randomIndex(&game.random, 64));
+        setBoardState(&game, pos, BOARD_STATIC, BOARD_VAL_OLD);
+    }
+    unsigned int bytes = arena->currentSize - sizeAtStart;
+
+    //NOTE: about a 1280x720 screen of 50 pixel cells
+    V2 halfViewMetres = v2(12.8f, 7.2f);
+    BoardCellRect visible = getVisibleBoardCells(&camera, halfViewMetres, boardWidth, boardHeight);
+    float sink = 0;
+    int chunksVisited = 0;
+    startTime = clock();
+    for(int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+        updateBoardFades(&game, FADE_TIMER_INTERVAL / 8, visible);
+        //NOTE: the same walk the render loop does, the chunks on screen that have been made
+        for(int chunkY = visible.minY >> BOARD_CHUNK_SHIFT; chunkY <= (visible.maxY >> BOARD_CHUNK_SHIFT); ++chunkY) {
+            for(int chunkX = visible.minX >> BOARD_CHUNK_SHIFT; chunkX <= (visible.maxX >> BOARD_CHUNK_SHIFT); ++chunkX) {
+                BoardChunk *chunk = game.board.chunks[chunkY*game.board.chunkCountX + chunkX];
+                if(!chunk) {
+                    continue;
+                }
+                chunksVisited++;
+                BoardCellRect cells = getChunkCellRect(chunkX, chunkY, visible);
+                for(int boardY = cells.minY; boardY <= cells.maxY; ++boardY) {
+                    for(int boardX = cells.minX; boardX <= cells.maxX; ++boardX) {
+                        sink += chunk->colors[getChunkCellIndex(boardX, boardY)].x;
+                    }
+                }
+                for(int fadeIndex = 0; fadeIndex < chunk->fadingCount; ++fadeIndex) {
+                    sink += getTimerValue01(&chunk->fadeTimers[chunk->fadingCells[fadeIndex]]);
+                }
+            }
+        }
+    }
+    double frameMilliseconds = getBenchMilliseconds(startTime);
+
+    startTime = clock();
+    initBoard(arena, &game, boardWidth, boardHeight, LEVEL_0, 0, false);
+    double restartMilliseconds = getBenchMilliseconds(startTime);
+
+    printf("huge board %dx%d: %.1fMB (a value per cell %.1fMB), made in %.2fms, restart %.2fms, a frame visits %d of %d chunks in %.5fms %s\n",
+           boardWidth, boardHeight, bytes / (1024.0*1024.0), oldBytes / (1024.0*1024.0), initMilliseconds, restartMilliseconds,
+           chunksVisited / frameCount, game.board.chunkCountX*game.board.chunkCountY, frameMilliseconds / frameCount, (sink < 0) ? "!" : "");
+
+    releaseMemoryMark(&memMark);
+}
+
+/*
+    Lots of things that step every so often, like windmills, each starting at a random point in its period. Compares
+    updating a Timer on every one of them each frame against the timer wheel, which only looks at the ones that fire.
+    Both only count the steps, the board isn't touched.
+*/
+void benchTimedEvents(Arena *arena, int eventCount, int frameCount) {
+    MemoryArenaMark memMark = takeMemoryMark(arena);
+
+    float period = 0.5f;
+    float dt = 1.0f / 60.0f;
+    int periodTicks = (int)(period*TIMER_WHEEL_TICKS_PER_SECOND);
+    RandomSeries random = initRandomSeries(0);
+    Timer *timers = pushArray(arena, eventCount, Timer);
+    int *startTicks = pushArray(arena, eventCount, int);
+    for(int eventIndex = 0; eventIndex < eventCount; ++eventIndex) {
+        startTicks[eventIndex] = 1 + randomIndex(&random, periodTicks);
+        timers[eventIndex] = initTimer(period);
+        timers[eventIndex].value = period*(float)(periodTicks - startTicks[eventIndex]) / periodTicks;
+    }
+
+    long long scanSteps = 0;
+    clock_t startTime = clock();
+    for(int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+        for(int eventIndex = 0; eventIndex < eventCount; ++eventIndex) {
+            TimerReturnInfo info = updateTimer(&timers[eventIndex], dt);
+            if(info.finished) {
+                turnTimerOn(&timers[eventIndex]);
+                scanSteps++;
+            }
+        }
+    }
+    double scanMilliseconds = getBenchMilliseconds(startTime);
+
+    TimerWheel wheel = {};
+    initTimerWheel(&wheel, arena);
+    for(int eventIndex = 0; eventIndex < eventCount; ++eventIndex) {
+        scheduleTimerEvent(&wheel, startTicks[eventIndex], TIMER_EVENT_EXTRA_SHAPE, eventIndex);
+    }
+    long long wheelSteps = 0;
+    startTime = clock();
+    for(int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+        advanceTimerWheel(&wheel, getTimerWheelTicks(&wheel, dt));
+        for(int firedIndex = 0; firedIndex < wheel.firedCount; ++firedIndex) {
+            scheduleTimerEvent(&wheel, wheel.currentTick + periodTicks, TIMER_EVENT_EXTRA_SHAPE, wheel.fired[firedIndex].data);
+        }
+        wheelSteps += wheel.firedCount;
+    }
+    double wheelMilliseconds = getBenchMilliseconds(startTime);
+    assert(wheel.eventCount == eventCount);
+
+    printf("timed events %d (%lld steps): timer each %.5fms, timer wheel %.5fms per frame (%.1fx)\n", eventCount,
+           wheelSteps, scanMilliseconds / frameCount, wheelMilliseconds / frameCount, scanMilliseconds / max(wheelMilliseconds, 0.001f));
+    //NOTE: the float timers drift a frame now and then, the counts should only be close
+    assert(scanSteps > wheelSteps*9/10 && scanSteps < wheelSteps*11/10);
+
+    releaseMemoryMark(&memMark);
+}
+
+/*
+    A board with far more windmills than the old 32 cap, spaced so their arms never meet. Times a frame of them on the
+    timer wheel, then checks that an undo snapshot taken before the frames puts the board and every windmill back.
+*/
+void benchManyWindmills(Arena *arena, int boardWidth, int boardHeight, int frameCount) {
+    MemoryArenaMark memMark = takeMemoryMark(arena);
+
+    GameState game = {};
+    initBenchGame(&game, arena, boardWidth, boardHeight);
+    int spacing = 8;
+    for(int boardY = spacing / 2; boardY < boardHeight; boardY += spacing) {
+        for(int boardX = spacing / 2; boardX < boardWidth; boardX += spacing) {
+            addExtraShape(&game, SHAPE_WINDMILL, v2(boardX, boardY));
+        }
+    }
+    int cellCount = boardWidth*boardHeight;
+    float dt = 1.0f / 60.0f;
+
+    UndoRing ring = {};
+    initUndoRing(&ring, boardWidth, boardHeight, UNDO_SNAPSHOT_COUNT);
+    clock_t startTime = clock();
+    pushBoardSnapshot(&ring, &game);
+    double pushMilliseconds = getBenchMilliseconds(startTime);
+    assert(ring.extraShapeCapacity >= game.extraShapeCount);
+
+    u8 *states = pushArray(arena, cellCount, u8);
+    memcpy(states, game.board.states, cellCount);
+    ExtraShape *extraShapes = pushArray(arena, game.extraShapeCount, ExtraShape);
+    memcpy(extraShapes, game.extraShapes, sizeof(ExtraShape)*game.extraShapeCount);
+    uint64_t tick = game.timerWheel.currentTick;
+
+    startTime = clock();
+    for(int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+        updateExtraShapes(&game, dt);
+    }
+    double frameMilliseconds = getBenchMilliseconds(startTime);
+    assert(memcmp(states, game.board.states, cellCount) != 0);
+
+    startTime = clock();
+    restoreBoardSnapshot(&ring, &game, 0);
+    double restoreMilliseconds = getBenchMilliseconds(startTime);
+
+    assert(memcmp(states, game.board.states, cellCount) == 0);
+    assert(game.zobristHash == computeZobristHash(&game));
+    for(int extraIndex = 0; extraIndex < game.extraShapeCount; ++extraIndex) {
+        ExtraShape *shape = &game.extraShapes[extraIndex];
+        ExtraShape *before = &extraShapes[extraIndex];
+        assert(shape->pos.x == before->pos.x && shape->pos.y == before->pos.y && shape->count == before->count &&
+               shape->onX == before->onX && shape->isOut == before->isOut);
+        assert(shape->fireTick - game.timerWheel.currentTick == before->fireTick - tick);
+    }
+    freeUndoRing(&ring);
+
+    printf("windmills %d on %dx%d: %.5fms a frame, snapshot %.3fms, restore %.3fms\n", game.extraShapeCount,
+           boardWidth, boardHeight, frameMilliseconds / frameCount, pushMilliseconds, restoreMilliseconds);
+
+    releaseMemoryMark(&memMark);
+}
+
+void benchRandom(int numberCount) {
+    RandomSeries series = initRandomSeries(0);
+    volatile float sink = 0;
+
+    clock_t startTime = clock();
+    float sum = 0;
+    for(int i = 0; i < numberCount; ++i) {
+        sum += (float)rand() / (float)RAND_MAX;
+    }
+    sink = sum;
+    double randMilliseconds = getBenchMilliseconds(startTime);
+
+    startTime = clock();
+    sum = 0;
+    for(int i = 0; i < numberCount; ++i) {
+        sum += randomUnilateral(&series);
+    }
+    sink = sum;
+    double seriesMilliseconds = getBenchMilliseconds(startTime);
+
+    printf("random floats: rand() %.1f, RandomSeries %.1f million a second\n",
+           numberCount / max(randMilliseconds, 0.001f) / 1000.0, numberCount / max(seriesMilliseconds, 0.001f) / 1000.0);
+}
+
+void runBenchmarks() {
+    Arena arena = createArena(Megabytes(512));
+
+    benchBoardScan(&arena, 64, 64, 20000);
+    benchBoardScan(&arena, 512, 512, 200);
+    benchBoardScan(&arena, 2048, 2048, 10);
+
+    benchWinCheck(&arena, 10, 20, 1000000);
+    benchWinCheck(&arena, 256, 4096, 20000);
+
+    benchShapeConnected(&arena, 10, 20, 20000);
+    benchShapeConnected(&arena, 256, 1024, 100);
+
+    benchDragTargets(&arena, 10, 20, 100000);
+
+    benchBoardFades(&arena, 10, 20, 4, 100000);
+    benchBoardFades(&arena, 256, 1024, 16, 1000);
+
+    benchSnapshots(&arena, 10, 20, 8, 200000);
+    benchSnapshots(&arena, 256, 1024, 16, 5000);
+
+    benchHugeBoard(&arena, 2000, 2000, 10000);
+
+    benchTimedEvents(&arena, 32, 1000000);
+    benchTimedEvents(&arena, 10000, 10000);
+
+    benchManyWindmills(&arena, 256, 256, 600);
+
+    benchRandom(50000000);
+}
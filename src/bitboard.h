@@ -0,0 +1,212 @@
+/*
+    Per row bit masks for the Fitris board. Bit x of a row is column x. Rows are stored as wordsPerRow 64 bit words
+    so the board can be any width. Columns past the edge of the board are always 0.
+
+    Every row has a zero guard word either side of it, so reading 64 columns at any offset (getMaskRowBits) doesn't need
+    to branch on the edges of the board.
+
+    gameSim.h keeps one mask each for BOARD_STATIC, BOARD_EXPLOSIVE and BOARD_SHAPE in sync in setBoardState.
+
+    It also keeps a count of the filled (STATIC or EXPLOSIVE) cells in each row and a bit per row that is set when that
+    count changes, so the line clear only has to look at the rows that changed since it last ran.
+
+    changedRows has a bit per row that is set when any cell of the row changes at all. The undo ring (boardSnapshot.h)
+    clears it when it takes a snapshot, so it knows which rows it has to copy.
+
+    layerRows has a bit per row that is set when a STATIC or EXPLOSIVE cell of the row changes, or stops fading. The
+    host keeps the settled cells drawn in a cached layer and clears it once it has redrawn those rows.
+*/
+#if _WIN32
+#include <intrin.h> //_BitScanForward64, __popcnt64
+#endif
+
+#define BOARD_MASK_WORD_BITS 64
+
+typedef struct {
+    int width;
+    int height;
+    int wordsPerRow;
+    int rowStride; //wordsPerRow plus the two guard words
+
+    uint64_t *staticRows;
+    uint64_t *explosiveRows;
+    uint64_t *shapeRows;
+
+    uint64_t *fullRow; //wordsPerRow words with a bit set for every column on the board
+
+    int *filledCounts; //STATIC or EXPLOSIVE cells in each row
+    int dirtyWordCount;
+    uint64_t *dirtyRows; //bit y is set when filledCounts[y] changed
+    uint64_t *changedRows; //bit y is set when anything in row y changed, dirtyWordCount words too
+    uint64_t *layerRows; //bit y is set when the settled cells of row y look different, dirtyWordCount words too
+} BoardMasks;
+
+static inline int countTrailingZeros64(uint64_t value) {
+    assert(value);
+#if _WIN32
+    unsigned long index = 0;
+    _BitScanForward64(&index, value);
+    int result = (int)index;
+#else
+    int result = __builtin_ctzll(value);
+#endif
+    return result;
+}
+
+static inline int countSetBits64(uint64_t value) {
+#if _WIN32
+    int result = (int)__popcnt64(value);
+#else
+    int result = __builtin_popcountll(value);
+#endif
+    return result;
+}
+
+void clearBoardMasks(BoardMasks *masks) {
+    size_t bytes = sizeof(uint64_t)*masks->rowStride*masks->height;
+    memset(masks->staticRows, 0, bytes);
+    memset(masks->explosiveRows, 0, bytes);
+    memset(masks->shapeRows, 0, bytes);
+    memset(masks->filledCounts, 0, sizeof(int)*masks->height);
+    memset(masks->dirtyRows, 0, sizeof(uint64_t)*masks->dirtyWordCount);
+    //NOTE: everything got cleared so every row changed
+    for(int y = 0; y < masks->height; ++y) {
+        masks->changedRows[y / BOARD_MASK_WORD_BITS] |= (uint64_t)1 << (y % BOARD_MASK_WORD_BITS);
+        masks->layerRows[y / BOARD_MASK_WORD_BITS] |= (uint64_t)1 << (y % BOARD_MASK_WORD_BITS);
+    }
+}
+
+//NOTE: Both masks have to be the same size.
+void copyBoardMasks(BoardMasks *dest, BoardMasks *src) {
+    assert(dest->width == src->width && dest->height == src->height);
+    size_t bytes = sizeof(uint64_t)*src->rowStride*src->height;
+    memcpy(dest->staticRows, src->staticRows, bytes);
+    memcpy(dest->explosiveRows, src->explosiveRows, bytes);
+    memcpy(dest->shapeRows, src->shapeRows, bytes);
+    memcpy(dest->filledCounts, src->filledCounts, sizeof(int)*src->height);
+    memcpy(dest->dirtyRows, src->dirtyRows, sizeof(uint64_t)*src->dirtyWordCount);
+    memcpy(dest->changedRows, src->changedRows, sizeof(uint64_t)*src->dirtyWordCount);
+    memcpy(dest->layerRows, src->layerRows, sizeof(uint64_t)*src->dirtyWordCount);
+}
+
+void initBoardMasks(Arena *arena, BoardMasks *masks, int width, int height) {
+    masks->width = width;
+    masks->height = height;
+    masks->wordsPerRow = (width + BOARD_MASK_WORD_BITS - 1) / BOARD_MASK_WORD_BITS;
+    masks->rowStride = masks->wordsPerRow + 2;
+
+    int wordCount = masks->rowStride*height;
+    masks->staticRows = pushArray(arena, wordCount, uint64_t);
+    masks->explosiveRows = pushArray(arena, wordCount, uint64_t);
+    masks->shapeRows = pushArray(arena, wordCount, uint64_t);
+
+    masks->fullRow = pushArray(arena, masks->wordsPerRow, uint64_t);
+    for(int wordIndex = 0; wordIndex < masks->wordsPerRow; ++wordIndex) {
+        int columnsLeft = width - wordIndex*BOARD_MASK_WORD_BITS;
+        if(columnsLeft >= BOARD_MASK_WORD_BITS) {
+            masks->fullRow[wordIndex] = ~(uint64_t)0;
+        } else {
+            masks->fullRow[wordIndex] = ((uint64_t)1 << columnsLeft) - 1;
+        }
+    }
+
+    masks->filledCounts = pushArray(arena, height, int);
+    masks->dirtyWordCount = (height + BOARD_MASK_WORD_BITS - 1) / BOARD_MASK_WORD_BITS;
+    masks->dirtyRows = pushArray(arena, masks->dirtyWordCount, uint64_t);
+    masks->changedRows = pushArray(arena, masks->dirtyWordCount, uint64_t);
+    masks->layerRows = pushArray(arena, masks->dirtyWordCount, uint64_t);
+}
+
+static inline uint64_t *getMaskRow(BoardMasks *masks, uint64_t *rows, int y) {
+    uint64_t *result = rows + y*masks->rowStride + 1; //skip the left guard word
+    return result;
+}
+
+static inline bool getMaskBit(BoardMasks *masks, uint64_t *rows, int x, int y) {
+    uint64_t *row = getMaskRow(masks, rows, y);
+    bool result = (row[x / BOARD_MASK_WORD_BITS] >> (x % BOARD_MASK_WORD_BITS)) & 1;
+    return result;
+}
+
+static inline void setMaskBit(BoardMasks *masks, uint64_t *rows, int x, int y, bool on) {
+    assert(x >= 0 && x < masks->width && y >= 0 && y < masks->height);
+    uint64_t *row = getMaskRow(masks, rows, y);
+    uint64_t bit = (uint64_t)1 << (x % BOARD_MASK_WORD_BITS);
+    if(on) {
+        row[x / BOARD_MASK_WORD_BITS] |= bit;
+    } else {
+        row[x / BOARD_MASK_WORD_BITS] &= ~bit;
+    }
+}
+
+//NOTE: The 64 columns of row y starting at startX, shifted down so startX is bit 0. startX can be up to 64 off
+//either side of the board, the guard words read as empty columns.
+static inline uint64_t getMaskRowBits(BoardMasks *masks, uint64_t *rows, int y, int startX) {
+    assert(startX >= -BOARD_MASK_WORD_BITS && startX <= masks->width);
+    uint64_t *row = getMaskRow(masks, rows, y) - 1; //include the left guard word
+    unsigned int bitIndex = startX + BOARD_MASK_WORD_BITS;
+    unsigned int wordIndex = bitIndex / BOARD_MASK_WORD_BITS;
+    unsigned int shift = bitIndex % BOARD_MASK_WORD_BITS;
+    //NOTE: shift the high word in two steps so a shift of 0 doesn't become an undefined shift by 64
+    uint64_t result = (row[wordIndex] >> shift) | ((row[wordIndex + 1] << 1) << (BOARD_MASK_WORD_BITS - 1 - shift));
+    return result;
+}
+
+static inline void setRowDirty(BoardMasks *masks, int y) {
+    assert(y >= 0 && y < masks->height);
+    masks->dirtyRows[y / BOARD_MASK_WORD_BITS] |= (uint64_t)1 << (y % BOARD_MASK_WORD_BITS);
+}
+
+static inline void setRowChanged(BoardMasks *masks, int y) {
+    assert(y >= 0 && y < masks->height);
+    masks->changedRows[y / BOARD_MASK_WORD_BITS] |= (uint64_t)1 << (y % BOARD_MASK_WORD_BITS);
+}
+
+static inline bool isRowChanged(BoardMasks *masks, int y) {
+    bool result = (masks->changedRows[y / BOARD_MASK_WORD_BITS] >> (y % BOARD_MASK_WORD_BITS)) & 1;
+    return result;
+}
+
+static inline void clearChangedRows(BoardMasks *masks) {
+    memset(masks->changedRows, 0, sizeof(uint64_t)*masks->dirtyWordCount);
+}
+
+static inline void setLayerRowChanged(BoardMasks *masks, int y) {
+    assert(y >= 0 && y < masks->height);
+    masks->layerRows[y / BOARD_MASK_WORD_BITS] |= (uint64_t)1 << (y % BOARD_MASK_WORD_BITS);
+}
+
+static inline bool isLayerRowChanged(BoardMasks *masks, int y) {
+    bool result = (masks->layerRows[y / BOARD_MASK_WORD_BITS] >> (y % BOARD_MASK_WORD_BITS)) & 1;
+    return result;
+}
+
+static inline void clearLayerRows(BoardMasks *masks) {
+    memset(masks->layerRows, 0, sizeof(uint64_t)*masks->dirtyWordCount);
+}
+
+static inline void changeRowFilledCount(BoardMasks *masks, int y, int change) {
+    masks->filledCounts[y] += change;
+    assert(masks->filledCounts[y] >= 0 && masks->filledCounts[y] <= masks->width);
+    setRowDirty(masks, y);
+}
+
+//NOTE: A row is full when every column is either STATIC or EXPLOSIVE
+static inline bool isRowFull(BoardMasks *masks, int y) {
+    bool result = (masks->filledCounts[y] == masks->width);
+    return result;
+}
+
+//NOTE: Same as isRowFull but from the masks, for checking the counts are right.
+static inline bool isMaskRowFull(BoardMasks *masks, int y) {
+    bool result = true;
+    uint64_t *staticRow = getMaskRow(masks, masks->staticRows, y);
+    uint64_t *explosiveRow = getMaskRow(masks, masks->explosiveRows, y);
+    for(int wordIndex = 0; wordIndex < masks->wordsPerRow; ++wordIndex) {
+        if((staticRow[wordIndex] | explosiveRow[wordIndex]) != masks->fullRow[wordIndex]) {
+            result = false;
+            break;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,86 @@
+/*
+    The view of the board. The right mouse button drags the board around and the scroll wheel zooms in & out on the
+    point under the mouse. When the whole board fits on screen along an axis it stays in the middle on that axis, so a
+    normal sized board looks the same as it always has.
+
+    Positions are in board cells, cell (x, y) is drawn centred on (x, y). Screen positions are pixels from the middle
+    of the screen, y up (KeyStates.mouseP_yUp).
+*/
+
+#define CAMERA_MIN_ZOOM 0.1f
+#define CAMERA_MAX_ZOOM 4.0f
+#define CAMERA_ZOOM_STEP 1.1f //per notch of the scroll wheel
+
+typedef struct {
+    V2 pos; //the board position in the middle of the screen
+    float zoom; //1 is the size the board has always been drawn at
+
+    bool dragging;
+    V2 dragStartScreenP;
+    V2 dragStartPos;
+} BoardCamera;
+
+static inline BoardCamera initBoardCamera(int boardWidth, int boardHeight) {
+    BoardCamera result = {};
+    result.pos = v2_scale(0.5f, v2((float)boardWidth - 1, (float)boardHeight - 1));
+    result.zoom = 1.0f;
+    return result;
+}
+
+//NOTE: screenMetres is a screen position already scaled to board cells at a zoom of 1 (by pixelsToMeters)
+static inline V2 screenToBoardP(BoardCamera *camera, V2 screenMetres) {
+    V2 result = v2_plus(camera->pos, v2_scale(1.0f / camera->zoom, screenMetres));
+    return result;
+}
+
+//NOTE: Keeps the board on screen, or in the middle along an axis it fits on.
+static inline float clampCameraAxis(float pos, float halfView, int boardSize) {
+    float boardMin = -0.5f;
+    float boardMax = boardSize - 0.5f;
+    float result = pos;
+    if(boardMax - boardMin <= 2*halfView) {
+        result = 0.5f*(boardSize - 1);
+    } else {
+        result = clamp(boardMin + halfView, pos, boardMax - halfView);
+    }
+    return result;
+}
+
+/*
+    halfViewMetres is half the screen in board cells at a zoom of 1, screenMetres is the mouse the same way.
+    scrollWheelY is the notches the wheel moved this frame.
+*/
+void updateBoardCamera(BoardCamera *camera, V2 halfViewMetres, V2 screenMetres, int scrollWheelY, bool panIsDown, int boardWidth, int boardHeight) {
+    if(scrollWheelY) {
+        V2 boardPUnderMouse = screenToBoardP(camera, screenMetres);
+        float zoom = camera->zoom*powf(CAMERA_ZOOM_STEP, (float)scrollWheelY);
+        camera->zoom = clamp(CAMERA_MIN_ZOOM, zoom, CAMERA_MAX_ZOOM);
+        camera->pos = v2_minus(boardPUnderMouse, v2_scale(1.0f / camera->zoom, screenMetres));
+    }
+
+    if(panIsDown && !camera->dragging) {
+        camera->dragging = true;
+        camera->dragStartScreenP = screenMetres;
+        camera->dragStartPos = camera->pos;
+    } else if(!panIsDown) {
+        camera->dragging = false;
+    }
+    if(camera->dragging) {
+        V2 dragMetres = v2_minus(screenMetres, camera->dragStartScreenP);
+        camera->pos = v2_minus(camera->dragStartPos, v2_scale(1.0f / camera->zoom, dragMetres));
+    }
+
+    camera->pos.x = clampCameraAxis(camera->pos.x, halfViewMetres.x / camera->zoom, boardWidth);
+    camera->pos.y = clampCameraAxis(camera->pos.y, halfViewMetres.y / camera->zoom, boardHeight);
+}
+
+BoardCellRect getVisibleBoardCells(BoardCamera *camera, V2 halfViewMetres, int boardWidth, int boardHeight) {
+    V2 halfView = v2_scale(1.0f / camera->zoom, halfViewMetres);
+    BoardCellRect result = {};
+    //NOTE: a cell reaches half a cell either side of its position
+    result.minX = (int)max(0, floorf(camera->pos.x - halfView.x + 0.5f));
+    result.minY = (int)max(0, floorf(camera->pos.y - halfView.y + 0.5f));
+    result.maxX = (int)min((float)boardWidth - 1, floorf(camera->pos.x + halfView.x + 0.5f));
+    result.maxY = (int)min((float)boardHeight - 1, floorf(camera->pos.y + halfView.y + 0.5f));
+    return result;
+}
@@ -0,0 +1,331 @@
+/*
+    Snapshots of the game for undo and for trying moves out. The board is split into bands of whole rows and a
+    snapshot keeps one reference per band to a row block (the states & types of that band). Bands that haven't changed
+    since the last snapshot share that snapshot's block, so taking a snapshot is O(bands) plus a copy of just the bands
+    that changed (copy on write). The board masks' changedRows bits say which rows those are.
+
+    A band is at least UNDO_MIN_BLOCK_BYTES, so on a big board it's one row but a small board like the normal 10x20 is
+    a single band and a snapshot is a whole board copy. Keeping track of each row costs more than that on a small board.
+
+    The ring also remembers which block each band of the live board matches, so restoring a snapshot only has to touch
+    the bands that differ from it. Those cells go through setBoardState so the masks, fades and zobrist hash stay right.
+
+    Colors, fade timers and prevStates aren't kept, they only change how the board is drawn. The cells a restore
+    changes fade in from what was there.
+
+    The row blocks are in the ring's own arena, made once by initUndoRing. The snapshots' extra shapes are in a second
+    arena with the same room in every snapshot. It's remade twice as big when a level has more extra shapes than fit,
+    which only happens on the first snapshot of a level with more of them than any level before. The ring keeps the
+    last capacity snapshots, taking one more drops the oldest.
+
+    The extra shapes' fire ticks are kept as they were. Restoring shifts them on by the ticks since the snapshot, so
+    each one is as far from stepping as it was, and puts them back on the timer wheel.
+*/
+
+#define UNDO_MIN_BLOCK_BYTES 512
+
+typedef struct {
+    int *blocks; //row block of each band
+
+    FitrisShape currentShape;
+    int extraShapeCount;
+    ExtraShape *extraShapes; //UndoRing.extraShapeCapacity of them
+    uint64_t tick; //the timer wheel's currentTick when the snapshot was taken
+    Timer moveTimer;
+    int lifePoints;
+    int experiencePoints;
+
+    uint64_t zobristHash; //the game's hash when the snapshot was taken, restoring gets back to it
+} BoardSnapshot;
+
+struct UndoRing {
+    Arena arena;
+    int boardWidth;
+    int boardHeight;
+
+    int rowsPerBand;
+    int bandCount; //the last band can have fewer rows
+
+    //NOTE: A row block is a band's states then its types, both rowsPerBand*boardWidth. Every snapshot and the live
+    //board hold at most one block a band, so (capacity + 1)*bandCount blocks is always enough.
+    int rowBlockCount;
+    u8 *rowBlocks;
+    int *rowBlockRefs;
+    int *freeRowBlocks;
+    int freeRowBlockCount;
+
+    int *liveBlocks; //the block each band of the live board matches, if the band hasn't changed since. -1 for none.
+
+    int capacity;
+    int firstSnapshot; //the oldest
+    int snapshotCount;
+    BoardSnapshot *snapshots;
+
+    Arena extraShapeArena;
+    int extraShapeCapacity; //each snapshot's room, grows with the levels
+};
+
+static inline size_t getBandCellCount(UndoRing *ring) {
+    size_t result = (size_t)ring->rowsPerBand*ring->boardWidth;
+    return result;
+}
+
+static inline u8 *getRowBlockStates(UndoRing *ring, int rowBlock) {
+    u8 *result = ring->rowBlocks + (size_t)rowBlock*2*getBandCellCount(ring);
+    return result;
+}
+
+static inline u8 *getRowBlockTypes(UndoRing *ring, int rowBlock) {
+    u8 *result = getRowBlockStates(ring, rowBlock) + getBandCellCount(ring);
+    return result;
+}
+
+static inline int getBandRowCount(UndoRing *ring, int band) {
+    int result = ring->boardHeight - band*ring->rowsPerBand;
+    if(result > ring->rowsPerBand) {
+        result = ring->rowsPerBand;
+    }
+    return result;
+}
+
+static inline bool isBandChanged(UndoRing *ring, BoardMasks *masks, int band) {
+    bool result = false;
+    int startY = band*ring->rowsPerBand;
+    int endY = startY + getBandRowCount(ring, band);
+    for(int boardY = startY; boardY < endY && !result; ++boardY) {
+        result = isRowChanged(masks, boardY);
+    }
+    return result;
+}
+
+static inline void addRowBlockRef(UndoRing *ring, int rowBlock) {
+    assert(rowBlock >= 0 && rowBlock < ring->rowBlockCount);
+    ring->rowBlockRefs[rowBlock]++;
+}
+
+static inline void releaseRowBlock(UndoRing *ring, int rowBlock) {
+    if(rowBlock >= 0) {
+        assert(ring->rowBlockRefs[rowBlock] > 0);
+        if(--ring->rowBlockRefs[rowBlock] == 0) {
+            ring->freeRowBlocks[ring->freeRowBlockCount++] = rowBlock;
+        }
+    }
+}
+
+static inline int allocRowBlock(UndoRing *ring) {
+    assert(ring->freeRowBlockCount > 0);
+    int result = ring->freeRowBlocks[--ring->freeRowBlockCount];
+    assert(ring->rowBlockRefs[result] == 0);
+    ring->rowBlockRefs[result] = 1;
+    return result;
+}
+
+static inline BoardSnapshot *getBoardSnapshot(UndoRing *ring, int age) {
+    assert(age >= 0 && age < ring->snapshotCount);
+    BoardSnapshot *result = &ring->snapshots[(ring->firstSnapshot + ring->snapshotCount - 1 - age) % ring->capacity];
+    return result;
+}
+
+static void releaseBoardSnapshotRows(UndoRing *ring, BoardSnapshot *snapshot) {
+    for(int band = 0; band < ring->bandCount; ++band) {
+        releaseRowBlock(ring, snapshot->blocks[band]);
+        snapshot->blocks[band] = -1;
+    }
+}
+
+void initUndoRing(UndoRing *ring, int boardWidth, int boardHeight, int capacity) {
+    assert(capacity > 0);
+    int rowsPerBand = (int)clamp(1, ceilf(UNDO_MIN_BLOCK_BYTES / (2.0f*boardWidth)), boardHeight);
+    int bandCount = (boardHeight + rowsPerBand - 1) / rowsPerBand;
+    size_t blockBytes = (size_t)2*rowsPerBand*boardWidth;
+    int rowBlockCount = (capacity + 1)*bandCount;
+    size_t arenaSize = (size_t)rowBlockCount*(blockBytes + 2*sizeof(int)) + sizeof(int)*bandCount +
+                       (size_t)capacity*(sizeof(BoardSnapshot) + sizeof(int)*bandCount) +
+                       Kilobytes(1);
+    ring->arena = createArena(arenaSize);
+    ring->boardWidth = boardWidth;
+    ring->boardHeight = boardHeight;
+    ring->rowsPerBand = rowsPerBand;
+    ring->bandCount = bandCount;
+
+    ring->rowBlockCount = rowBlockCount;
+    ring->rowBlocks = pushArray(&ring->arena, (size_t)rowBlockCount*blockBytes, u8);
+    ring->rowBlockRefs = pushArray(&ring->arena, rowBlockCount, int);
+    ring->freeRowBlocks = pushArray(&ring->arena, rowBlockCount, int);
+    ring->liveBlocks = pushArray(&ring->arena, bandCount, int);
+
+    ring->capacity = capacity;
+    ring->snapshots = pushArray(&ring->arena, capacity, BoardSnapshot);
+    for(int snapshotIndex = 0; snapshotIndex < capacity; ++snapshotIndex) {
+        ring->snapshots[snapshotIndex].blocks = pushArray(&ring->arena, bandCount, int);
+    }
+
+    ring->freeRowBlockCount = 0;
+    for(int rowBlock = rowBlockCount - 1; rowBlock >= 0; --rowBlock) {
+        ring->freeRowBlocks[ring->freeRowBlockCount++] = rowBlock;
+    }
+    for(int band = 0; band < bandCount; ++band) {
+        ring->liveBlocks[band] = -1;
+    }
+    for(int snapshotIndex = 0; snapshotIndex < capacity; ++snapshotIndex) {
+        for(int band = 0; band < bandCount; ++band) {
+            ring->snapshots[snapshotIndex].blocks[band] = -1;
+        }
+    }
+    ring->firstSnapshot = 0;
+    ring->snapshotCount = 0;
+
+    ring->extraShapeArena = {};
+    ring->extraShapeCapacity = 0;
+}
+
+void freeUndoRing(UndoRing *ring) {
+    free(ring->arena.memory);
+    free(ring->extraShapeArena.memory);
+    zeroStruct(ring, UndoRing);
+}
+
+//NOTE: Drops every snapshot, say when the level restarts.
+void clearUndoRing(UndoRing *ring) {
+    for(int age = 0; age < ring->snapshotCount; ++age) {
+        releaseBoardSnapshotRows(ring, getBoardSnapshot(ring, age));
+    }
+    ring->firstSnapshot = 0;
+    ring->snapshotCount = 0;
+}
+
+//NOTE: Remakes the snapshots' extra shape arrays with room for at least extraShapeCount, keeping what they hold.
+static void growSnapshotExtraShapes(UndoRing *ring, int extraShapeCount) {
+    int newCapacity = (ring->extraShapeCapacity > 0) ? 2*ring->extraShapeCapacity : 8;
+    while(newCapacity < extraShapeCount) {
+        newCapacity *= 2;
+    }
+    Arena arena = createArena((size_t)ring->capacity*newCapacity*sizeof(ExtraShape));
+    for(int snapshotIndex = 0; snapshotIndex < ring->capacity; ++snapshotIndex) {
+        BoardSnapshot *snapshot = &ring->snapshots[snapshotIndex];
+        ExtraShape *extraShapes = pushArray(&arena, newCapacity, ExtraShape);
+        if(snapshot->extraShapeCount > 0) {
+            memcpy(extraShapes, snapshot->extraShapes, sizeof(ExtraShape)*snapshot->extraShapeCount);
+        }
+        snapshot->extraShapes = extraShapes;
+    }
+    free(ring->extraShapeArena.memory);
+    ring->extraShapeArena = arena;
+    ring->extraShapeCapacity = newCapacity;
+}
+
+void pushBoardSnapshot(UndoRing *ring, GameState *game) {
+    assert(ring->boardWidth == game->boardWidth && ring->boardHeight == game->boardHeight);
+    if(ring->snapshotCount == ring->capacity) {
+        releaseBoardSnapshotRows(ring, &ring->snapshots[ring->firstSnapshot]);
+        ring->firstSnapshot = (ring->firstSnapshot + 1) % ring->capacity;
+        ring->snapshotCount--;
+    }
+    BoardSnapshot *snapshot = &ring->snapshots[(ring->firstSnapshot + ring->snapshotCount) % ring->capacity];
+    ring->snapshotCount++;
+
+    BoardMasks *masks = &game->masks;
+    for(int band = 0; band < ring->bandCount; ++band) {
+        if(ring->liveBlocks[band] < 0 || isBandChanged(ring, masks, band)) {
+            //NOTE: the copy on write, the band changed so it gets its own block
+            int rowBlock = allocRowBlock(ring);
+            size_t boardIndex = (size_t)band*getBandCellCount(ring);
+            size_t cellCount = (size_t)getBandRowCount(ring, band)*game->boardWidth;
+            memcpy(getRowBlockStates(ring, rowBlock), game->board.states + boardIndex, cellCount);
+            memcpy(getRowBlockTypes(ring, rowBlock), game->board.types + boardIndex, cellCount);
+            releaseRowBlock(ring, ring->liveBlocks[band]);
+            ring->liveBlocks[band] = rowBlock;
+        }
+        snapshot->blocks[band] = ring->liveBlocks[band];
+        addRowBlockRef(ring, snapshot->blocks[band]);
+    }
+    clearChangedRows(masks);
+
+    snapshot->currentShape = game->currentShape;
+    if(game->extraShapeCount > ring->extraShapeCapacity) {
+        growSnapshotExtraShapes(ring, game->extraShapeCount);
+    }
+    snapshot->extraShapeCount = game->extraShapeCount;
+    if(game->extraShapeCount > 0) {
+        memcpy(snapshot->extraShapes, game->extraShapes, sizeof(ExtraShape)*game->extraShapeCount);
+    }
+    snapshot->tick = game->timerWheel.currentTick;
+    snapshot->moveTimer = game->moveTimer;
+    snapshot->lifePoints = game->lifePoints;
+    snapshot->experiencePoints = game->experiencePoints;
+    snapshot->zobristHash = game->zobristHash;
+}
+
+//NOTE: Puts the game back to the snapshot age snapshots ago (0 is the newest). The snapshot stays in the ring.
+void restoreBoardSnapshot(UndoRing *ring, GameState *game, int age) {
+    BoardSnapshot *snapshot = getBoardSnapshot(ring, age);
+    BoardMasks *masks = &game->masks;
+    for(int band = 0; band < ring->bandCount; ++band) {
+        int rowBlock = snapshot->blocks[band];
+        if(ring->liveBlocks[band] == rowBlock && !isBandChanged(ring, masks, band)) {
+            continue; //still shared, nothing to do
+        }
+        u8 *states = getRowBlockStates(ring, rowBlock);
+        u8 *types = getRowBlockTypes(ring, rowBlock);
+        int startY = band*ring->rowsPerBand;
+        int cellCount = getBandRowCount(ring, band)*game->boardWidth;
+        for(int cellIndex = 0; cellIndex < cellCount; ++cellIndex) {
+            int boardIndex = startY*game->boardWidth + cellIndex;
+            if(game->board.states[boardIndex] != states[cellIndex] || game->board.types[boardIndex] != types[cellIndex]) {
+                V2 pos = v2(cellIndex % game->boardWidth, startY + cellIndex / game->boardWidth);
+                setBoardState(game, pos, (BoardState)states[cellIndex], (BoardValType)types[cellIndex]);
+                setBoardColor(game, pos, COLOR_WHITE);
+            }
+        }
+        releaseRowBlock(ring, ring->liveBlocks[band]);
+        ring->liveBlocks[band] = rowBlock;
+        addRowBlockRef(ring, rowBlock);
+    }
+    //NOTE: every band matches its block again
+    clearChangedRows(masks);
+
+    FitrisShape *shape = &game->currentShape;
+    for(int i = 0; i < shape->count; ++i) {
+        toggleShapeZobrist(game, shape, shape->coords[i]);
+    }
+    *shape = snapshot->currentShape;
+    for(int i = 0; i < shape->count; ++i) {
+        toggleShapeZobrist(game, shape, shape->coords[i]);
+    }
+    //NOTE: the level's extra shapes don't come and go, so the game's array is already big enough
+    assert(snapshot->extraShapeCount <= game->extraShapeCapacity);
+    game->extraShapeCount = snapshot->extraShapeCount;
+    if(snapshot->extraShapeCount > 0) {
+        memcpy(game->extraShapes, snapshot->extraShapes, sizeof(ExtraShape)*snapshot->extraShapeCount);
+    }
+    //NOTE: every event on the wheel is an extra shape's
+    TimerWheel *wheel = &game->timerWheel;
+    clearTimerWheel(wheel);
+    for(int extraIndex = 0; extraIndex < game->extraShapeCount; ++extraIndex) {
+        scheduleExtraShape(game, extraIndex, game->extraShapes[extraIndex].fireTick + (wheel->currentTick - snapshot->tick));
+    }
+    game->moveTimer = snapshot->moveTimer;
+    game->lifePoints = snapshot->lifePoints;
+    game->experiencePoints = snapshot->experiencePoints;
+    game->createShape = false;
+    game->wasHitByExplosive = false;
+    resetMouseUI(game);
+
+    assert(game->zobristHash == snapshot->zobristHash);
+}
+
+/*
+    The player's undo. Goes back to where the current shape spawned, or if the shape hasn't done anything since then
+    to where the shape before it spawned. Returns false if there is nothing to go back to.
+*/
+bool undoBoardSnapshot(UndoRing *ring, GameState *game) {
+    if(ring->snapshotCount > 1 && getBoardSnapshot(ring, 0)->zobristHash == game->zobristHash) {
+        releaseBoardSnapshotRows(ring, getBoardSnapshot(ring, 0));
+        ring->snapshotCount--;
+    }
+    bool result = (ring->snapshotCount > 0);
+    if(result) {
+        restoreBoardSnapshot(ring, game, 0);
+    }
+    return result;
+}
@@ -0,0 +1 @@
+cl /O2 /DNOMINMAX /I../shared /Zi headless.cpp /Fe../bin/headless.exe
@@ -0,0 +1,2 @@
+ERRORS_OFF=-Wno-c++11-compat-deprecated-writable-strings
+clang++ $ERRORS_OFF -std=c++14 -O2 -pthread -I ../shared/ headless.cpp -o ../bin/headless -g
@@ -2,9 +2,13 @@
 #define FADE_TIMER_INTERVAL 0.3f
 #define SCENE_TRANSITION_TIME 0.3f
 #define BOARD_WIDTH 5
-#define BOARD_HEIGHT 10
+#define BOARD_HEIGHT 10 //the board can go up to thousands a side for events, it is stored & drawn in chunks (see BoardChunk)
 #define START_LEVEL LEVEL_2
 #define START_MENU_MODE MENU_MODE
+#define REPLAY_FILE_NAME "last_game.replay" //written next to the resources
+#define LEVEL_FILE_NAME "levels.bin" //made by: headless levels <file>. Optional, the levels are random without it.
+#define SHAPE_FILE_NAME "shapes.txt" //the shapes a new shape can be, see shapeCatalogue.h. Optional.
+#define UNDO_SNAPSHOT_COUNT 32 //how many shapes back the player can undo (Z)
 #define CAN_ALTER_SHAPE_DIAGONAL 0 //this is if you can move a block to a position only situated diagonally 
 #define CAN_MOVE_WITH_ARROW_KEYS 0
 #define OPENGL_BACKEND 1
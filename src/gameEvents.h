@@ -0,0 +1,58 @@
+/*
+    What happened in the game logic this frame, for the host to react to. The logic pushes typed events as it goes
+    and never calls out to audio, particles or UI itself, so it runs the same headless and on any thread. The host
+    takes the events once a frame after stepGame with popGameEvent, which is where it can play one sound for three
+    explosives going off in the same frame.
+
+    The queue is a ring. Nothing has to read it: when it's full the oldest events are dropped (droppedCount), so a
+    headless game that never looks at it costs a store per event.
+*/
+
+#define GAME_EVENT_QUEUE_SIZE 256 //has to be a power of 2
+
+typedef enum {
+    GAME_EVENT_MOVED, //pos is the move, or the value is 1 & pos 0 if the shape turned
+    GAME_EVENT_SOLIDIFIED, //the shape turned into STATIC blocks, value is how many
+    GAME_EVENT_EXPLODED, //a block of the shape hit an explosive, pos is the explosive
+    GAME_EVENT_ROW_CLEARED, //pos.y & value are the row
+
+    GAME_EVENT_TYPE_COUNT
+} GameEventType;
+
+typedef struct {
+    GameEventType type;
+    V2 pos;
+    int value;
+} GameEvent;
+
+typedef struct {
+    GameEvent events[GAME_EVENT_QUEUE_SIZE];
+    uint32_t writeAt; //both only go up, the slot is the index masked by the size
+    uint32_t readAt;
+    int droppedCount;
+} GameEventQueue;
+
+static inline void clearGameEvents(GameEventQueue *queue) {
+    queue->readAt = queue->writeAt = 0;
+    queue->droppedCount = 0;
+}
+
+static inline void pushGameEvent(GameEventQueue *queue, GameEventType type, V2 pos, int value) {
+    if(queue->writeAt - queue->readAt == GAME_EVENT_QUEUE_SIZE) {
+        queue->readAt++;
+        queue->droppedCount++;
+    }
+    GameEvent *event = &queue->events[queue->writeAt++ & (GAME_EVENT_QUEUE_SIZE - 1)];
+    event->type = type;
+    event->pos = pos;
+    event->value = value;
+}
+
+//NOTE: Oldest first. Returns false when there are none left.
+static inline bool popGameEvent(GameEventQueue *queue, GameEvent *event) {
+    bool result = (queue->readAt != queue->writeAt);
+    if(result) {
+        *event = queue->events[queue->readAt++ & (GAME_EVENT_QUEUE_SIZE - 1)];
+    }
+    return result;
+}
@@ -0,0 +1,1501 @@
+/*
+    The Fitris game logic. Nothing in here touches SDL, OpenGL or the audio mixer so it can be stepped
+    headless (see headless.cpp) as well as by gameUpdateAndRender in main.cpp.
+
+    Usage:
+        initBoard(...) to create a level
+        stepGame(game, &input, dt) once per frame
+        getBoardState/getBoardValue etc. to query the board
+
+    The host is told what happened through game->events (gameEvents.h), and has to call restartLevel when stepGame
+    sets retryLevel.
+*/
+#include "bitboard.h"
+#include "timerWheel.h"
+#include "gameEvents.h"
+
+typedef enum {
+    BOARD_NULL,
+    BOARD_STATIC,
+    BOARD_SHAPE,
+    BOARD_EXPLOSIVE,
+    BOARD_INVALID, //For out of bounds
+} BoardState;
+
+#define MAX_SHAPE_COUNT 16
+#include "shapeCatalogue.h"
+
+typedef struct {
+    V2 coords[MAX_SHAPE_COUNT];
+    int count;
+    bool valid;
+
+    //NOTE: the catalogue mask the coords still match, with its bottom left corner at maskOrigin. NULL once a block is
+    //dragged or blown off, the shape then goes back to looking at its coords.
+    const ShapeMask *mask;
+    V2 maskOrigin;
+    int catalogueIndex;
+    int rotation;
+
+    Timer moveTimer;
+} FitrisShape;
+
+typedef enum {
+    SHAPE_WINDMILL,
+} ExtraShapeType;
+
+typedef struct {
+    ExtraShapeType type;
+    V2 pos;
+
+    int periodTicks; //how often it steps
+    uint64_t fireTick; //when it next steps, on the game's timerWheel
+    int eventIndex; //its event on the timerWheel
+
+    bool onX; //on x or on y
+    bool isOut; //going out or in
+
+    int count;
+
+    int xMax;
+    int yMax;
+
+} ExtraShape;
+
+typedef enum {
+    BOARD_VAL_NULL,
+    BOARD_VAL_OLD,
+    BOARD_VAL_ALWAYS,
+    BOARD_VAL_TRANSIENT, //this isn't used for anything, just to make it so we aren't using the other ones.
+} BoardValType;
+
+//NOTE: One cell of the board gathered together, what getBoardValue hands back. The board isn't stored like this, see BoardArrays.
+typedef struct {
+    BoardValType type;
+    BoardState state;
+    BoardState prevState;
+
+    V4 color;
+
+    Timer fadeTimer;
+} BoardValue;
+
+/*
+    What only the render loop reads about a BOARD_CHUNK_SIZE square of cells, indexed by getChunkCellIndex. A chunk is
+    made the first time a cell in it changes, until then every cell in it is empty, white and not fading. So a huge
+    board only pays for the parts that have been played on, and drawing it only looks at the chunks on screen.
+
+    Each chunk keeps its own list of fading cells. updateBoardFades only moves on the chunks it is given (the ones on
+    screen), a chunk off screen catches up on the time it missed (fadeClock) when it is next updated or a cell in it
+    starts fading.
+*/
+#define BOARD_CHUNK_SHIFT 5
+#define BOARD_CHUNK_SIZE (1 << BOARD_CHUNK_SHIFT) //32x32 cells
+#define BOARD_CHUNK_CELL_COUNT (BOARD_CHUNK_SIZE*BOARD_CHUNK_SIZE)
+
+typedef struct {
+    u8 prevStates[BOARD_CHUNK_CELL_COUNT]; //BoardState we are fading from
+    V4 colors[BOARD_CHUNK_CELL_COUNT];
+    Timer fadeTimers[BOARD_CHUNK_CELL_COUNT];
+    int fadeSlots[BOARD_CHUNK_CELL_COUNT]; //index into fadingCells, -1 when the cell isn't fading
+    u16 fadingCells[BOARD_CHUNK_CELL_COUNT]; //chunk cell indexes
+    int fadingCount;
+    float fadeClock; //the board's fadeClock when the fade timers were last moved on
+} BoardChunk;
+
+//NOTE: A rect of board cells, inclusive. Empty if minX > maxX or minY > maxY.
+typedef struct {
+    int minX;
+    int minY;
+    int maxX;
+    int maxY;
+} BoardCellRect;
+
+//NOTE: The board stored as separate arrays. The game logic only reads the one byte states & types, indexed by
+//boardWidth*y + x. The colors and fade timers are only read by the render loop so they live in chunks out of the way.
+typedef struct {
+    u8 *states; //BoardState
+    u8 *types; //BoardValType
+
+    int chunkCountX;
+    int chunkCountY;
+    BoardChunk **chunks; //chunkCountX*chunkCountY, null until a cell in the chunk changes
+    int *usedChunks; //indexes of the chunks that have been made, so a restart or a copy only goes through those
+    int usedChunkCount;
+
+    float fadeClock; //all the time updateBoardFades has been given
+} BoardArrays;
+
+//NOTE: Bigger than any island of the shape plus the empty cells around it.
+#define DRAG_TARGET_MAP_SIZE (MAX_SHAPE_COUNT + 2)
+
+//NOTE: Every cell the held block can be dragged to. Worked out when a drag starts and again only when the board changes.
+typedef struct {
+    bool valid;
+    int hotIndex;
+    uint32_t boardChangeCount;
+
+    int minX; //board cell of bit 0 of rows[0]
+    int minY;
+    uint32_t rows[DRAG_TARGET_MAP_SIZE]; //bit x of rows[y] is the cell (minX + x, minY + y)
+} DragTargetMap;
+
+typedef enum {
+    LEVEL_0,
+    LEVEL_1,
+    LEVEL_2,
+    LEVEL_3,
+    LEVEL_4,
+} LevelType;
+
+typedef struct UndoRing UndoRing; //boardSnapshot.h
+typedef struct LevelFile LevelFile; //levelFile.h
+
+//NOTE: Totals over the whole session, restartLevel doesn't reset them. Used for balancing the levels.
+typedef struct {
+    int linesCleared;
+    int explosivesHit; //life points lost to BOARD_EXPLOSIVE
+    int levelsFailed;
+} GameStats;
+
+typedef struct {
+    int boardWidth;
+    int boardHeight;
+    BoardArrays board;
+    BoardMasks masks; //mirror of the board states as bits, kept in sync by setBoardState
+    uint32_t boardChangeCount; //goes up every time a cell changes state, so caches of the board know when they are stale
+    uint64_t zobristHash; //of every cell's state & type and the currentShape coords, see getZobristHash
+
+    FitrisShape currentShape;
+    const ShapeCatalogue *shapes; //what a new shape can be, initGame sets it to defaultShapeCatalogue if it isn't set
+
+    int lifePoints;
+    int lifePointsMax;
+    bool wasHitByExplosive;
+
+    int extraShapeCount;
+    int extraShapeCapacity;
+    ExtraShape *extraShapes; //doubles on the arena when it fills
+    TimerWheel timerWheel; //when each extra shape next steps, so a frame only looks at the ones that are due
+
+    bool createShape;
+    bool retryLevel; //the shape couldn't spawn or we ran out of lives. The host has to call restartLevel.
+
+    int currentBlockCount;
+    LevelType currentLevelType;
+
+    Timer moveTimer;
+
+    int currentHotIndex;
+    DragTargetMap dragTargets;
+
+    int experiencePoints;
+    GameStats stats;
+
+    float slowTimeFactor;
+
+    RandomSeries random; //the level layouts come from this. Seed it before initBoard, the same seed gives the same levels.
+
+    Arena *arena; //the board arrays live here
+
+    UndoRing *undo; //can be null. When set a snapshot is taken every time a shape spawns and BUTTON_Z goes back to it.
+    LevelFile *levels; //can be null. Set before initGame and createLevel picks the levels from it when it has any.
+
+    GameEventQueue events; //what happened, for the host to play sounds & effects from
+} GameState;
+
+//NOTE: The inputs the game logic consumes for one frame. The host fills this out from gameButtons & the mouse.
+typedef struct {
+    GameButton buttons[BUTTON_COUNT];
+    V2 mouseBoardP; //the board cell the mouse is over (see getMouseBoardCell), not clamped to the board
+} GameInput;
+
+//NOTE: The sim only cares which cell the mouse is over, so hosts round it before it goes in GameInput. That way a
+//recorded game replays the same.
+static inline V2 getMouseBoardCell(V2 mouseBoardP) {
+    V2 result = v2(floorf(mouseBoardP.x + 0.5f), floorf(mouseBoardP.y + 0.5f));
+    return result;
+}
+
+typedef enum {
+    MOVE_LEFT,
+    MOVE_RIGHT,
+    MOVE_DOWN
+} MoveType;
+
+/*
+    Zobrist hashing: the hash of the game is the xor of a key for each cell's state, each cell's type and each block
+    of the current shape, so a change to one cell is two xors. BOARD_NULL and BOARD_VAL_NULL have a key of 0 so an
+    empty board hashes to 0.
+
+    The keys are a hash of the board index & what is in the cell rather than a table of random numbers, so big boards
+    don't need a big table and every GameState (and the placement search) uses the same keys.
+*/
+#define ZOBRIST_STATE_SLOT 0 //plus the BoardState
+#define ZOBRIST_TYPE_SLOT (ZOBRIST_STATE_SLOT + BOARD_INVALID) //plus the BoardValType
+#define ZOBRIST_SHAPE_SLOT (ZOBRIST_TYPE_SLOT + BOARD_VAL_TRANSIENT + 1)
+
+static inline uint64_t getZobristKey(int boardIndex, int slot) {
+    //NOTE: splitmix64's finalizer
+    uint64_t key = ((uint64_t)(uint32_t)boardIndex << 4 | (uint64_t)slot) + 0x9E3779B97F4A7C15ULL;
+    key = (key ^ (key >> 30))*0xBF58476D1CE4E5B9ULL;
+    key = (key ^ (key >> 27))*0x94D049BB133111EBULL;
+    key = key ^ (key >> 31);
+    return key;
+}
+
+static inline uint64_t getZobristStateKey(int boardIndex, BoardState state) {
+    uint64_t result = (state == BOARD_NULL) ? 0 : getZobristKey(boardIndex, ZOBRIST_STATE_SLOT + state);
+    return result;
+}
+
+static inline uint64_t getZobristTypeKey(int boardIndex, BoardValType type) {
+    uint64_t result = (type == BOARD_VAL_NULL) ? 0 : getZobristKey(boardIndex, ZOBRIST_TYPE_SLOT + type);
+    return result;
+}
+
+static inline uint64_t getZobristShapeKey(int boardIndex) {
+    uint64_t result = getZobristKey(boardIndex, ZOBRIST_SHAPE_SLOT);
+    return result;
+}
+
+static inline uint64_t getZobristHash(GameState *game) {
+    return game->zobristHash;
+}
+
+static inline int getBoardIndex(GameState *game, V2 pos) {
+    int result = game->boardWidth*(int)pos.y + (int)pos.x;
+    return result;
+}
+
+static inline int getBoardChunkIndex(BoardArrays *board, int x, int y) {
+    int result = (y >> BOARD_CHUNK_SHIFT)*board->chunkCountX + (x >> BOARD_CHUNK_SHIFT);
+    return result;
+}
+
+static inline int getChunkCellIndex(int x, int y) {
+    int result = ((y & (BOARD_CHUNK_SIZE - 1)) << BOARD_CHUNK_SHIFT) | (x & (BOARD_CHUNK_SIZE - 1));
+    return result;
+}
+
+//NOTE: null if nothing in the chunk has changed yet
+static inline BoardChunk *findBoardChunk(BoardArrays *board, int x, int y) {
+    BoardChunk *result = board->chunks[getBoardChunkIndex(board, x, y)];
+    return result;
+}
+
+void resetBoardChunk(BoardChunk *chunk) {
+    for(int cellIndex = 0; cellIndex < BOARD_CHUNK_CELL_COUNT; ++cellIndex) {
+        chunk->prevStates[cellIndex] = BOARD_NULL;
+        chunk->colors[cellIndex] = COLOR_WHITE;
+        chunk->fadeTimers[cellIndex].value = -1;
+        chunk->fadeSlots[cellIndex] = -1;
+    }
+    chunk->fadingCount = 0;
+}
+
+//NOTE: The part of rect in the chunk at chunkX, chunkY.
+static inline BoardCellRect getChunkCellRect(int chunkX, int chunkY, BoardCellRect rect) {
+    BoardCellRect result = {};
+    result.minX = (int)max(rect.minX, chunkX << BOARD_CHUNK_SHIFT);
+    result.minY = (int)max(rect.minY, chunkY << BOARD_CHUNK_SHIFT);
+    result.maxX = (int)min(rect.maxX, (chunkX << BOARD_CHUNK_SHIFT) + BOARD_CHUNK_SIZE - 1);
+    result.maxY = (int)min(rect.maxY, (chunkY << BOARD_CHUNK_SHIFT) + BOARD_CHUNK_SIZE - 1);
+    return result;
+}
+
+//NOTE: Makes the chunk on the game's arena if it isn't there yet.
+BoardChunk *getBoardChunk(GameState *game, int x, int y) {
+    BoardArrays *board = &game->board;
+    int chunkIndex = getBoardChunkIndex(board, x, y);
+    BoardChunk *result = board->chunks[chunkIndex];
+    if(!result) {
+        result = board->chunks[chunkIndex] = pushStruct(game->arena, BoardChunk);
+        resetBoardChunk(result);
+        board->usedChunks[board->usedChunkCount++] = chunkIndex;
+    }
+    return result;
+}
+
+//NOTE: Pushes the board's arrays for boardWidth x boardHeight, with no chunks made yet.
+void initBoardArrays(Arena *arena, BoardArrays *board, int boardWidth, int boardHeight) {
+    int cellCount = boardWidth*boardHeight;
+    board->states = pushArray(arena, cellCount, u8);
+    board->types = pushArray(arena, cellCount, u8);
+    board->chunkCountX = (boardWidth + BOARD_CHUNK_SIZE - 1) >> BOARD_CHUNK_SHIFT;
+    board->chunkCountY = (boardHeight + BOARD_CHUNK_SIZE - 1) >> BOARD_CHUNK_SHIFT;
+    int chunkCount = board->chunkCountX*board->chunkCountY;
+    board->chunks = pushArray(arena, chunkCount, BoardChunk *);
+    board->usedChunks = pushArray(arena, chunkCount, int);
+    board->usedChunkCount = 0;
+    board->fadeClock = 0;
+}
+
+BoardState getBoardState(GameState *game, V2 pos) {
+    BoardState result = BOARD_INVALID;
+    if(pos.x >= 0 && pos.x < game->boardWidth && pos.y >= 0 && pos.y < game->boardHeight) {
+        result = (BoardState)game->board.states[getBoardIndex(game, pos)];
+        assert(result != BOARD_INVALID);
+    }
+
+    return result;
+}
+
+BoardValue getBoardValue(GameState *game, V2 pos) {
+    BoardValue result = {};
+    if(pos.x >= 0 && pos.x < game->boardWidth && pos.y >= 0 && pos.y < game->boardHeight) {
+        int boardIndex = getBoardIndex(game, pos);
+        result.type = (BoardValType)game->board.types[boardIndex];
+        result.state = (BoardState)game->board.states[boardIndex];
+        BoardChunk *chunk = findBoardChunk(&game->board, (int)pos.x, (int)pos.y);
+        if(chunk) {
+            int cellIndex = getChunkCellIndex((int)pos.x, (int)pos.y);
+            result.prevState = (BoardState)chunk->prevStates[cellIndex];
+            result.color = chunk->colors[cellIndex];
+            result.fadeTimer = chunk->fadeTimers[cellIndex];
+        } else {
+            result.color = COLOR_WHITE;
+            result.fadeTimer.value = -1;
+        }
+    } else {
+        assert(!"invalid code path");
+    }
+
+    return result;
+}
+
+bool inBoardBounds(GameState *game, V2 pos) {
+    bool result = false;
+    if(pos.x >= 0 && pos.x < game->boardWidth && pos.y >= 0 && pos.y < game->boardHeight) {
+        result = true;
+    }
+    return result;
+}
+
+static inline bool isFilledState(BoardState state) {
+    bool result = (state == BOARD_STATIC || state == BOARD_EXPLOSIVE);
+    return result;
+}
+
+static inline void setBoardMasks(GameState *game, V2 pos, BoardState oldState, BoardState state) {
+    BoardMasks *masks = &game->masks;
+    int x = (int)pos.x;
+    int y = (int)pos.y;
+    int boardIndex = getBoardIndex(game, pos);
+    game->zobristHash ^= getZobristStateKey(boardIndex, oldState) ^ getZobristStateKey(boardIndex, state);
+    setMaskBit(masks, masks->staticRows, x, y, state == BOARD_STATIC);
+    setMaskBit(masks, masks->explosiveRows, x, y, state == BOARD_EXPLOSIVE);
+    setMaskBit(masks, masks->shapeRows, x, y, state == BOARD_SHAPE);
+    setRowChanged(masks, y);
+    game->boardChangeCount++;
+
+    if(isFilledState(state) || isFilledState(oldState)) {
+        setLayerRowChanged(masks, y);
+    }
+
+    int filledChange = (int)isFilledState(state) - (int)isFilledState(oldState);
+    if(filledChange) {
+        changeRowFilledCount(masks, y, filledChange);
+    }
+}
+
+//NOTE: Only changes the state, no fade & the previous state is kept. Use setBoardState unless you are going to put the state back straight after.
+static inline void setBoardStateInPlace(GameState *game, V2 pos, BoardState state) {
+    assert(inBoardBounds(game, pos));
+    int boardIndex = getBoardIndex(game, pos);
+    BoardState oldState = (BoardState)game->board.states[boardIndex];
+    game->board.states[boardIndex] = state;
+    setBoardMasks(game, pos, oldState, state);
+}
+
+//NOTE: Moves the fade timers of the chunk's fading cells on to the board's fadeClock. A cell that finishes fading has
+//its previous state set to its current one and drops off the chunk's list.
+static void updateChunkFades(GameState *game, int chunkIndex) {
+    BoardArrays *board = &game->board;
+    BoardChunk *chunk = board->chunks[chunkIndex];
+    float dt = board->fadeClock - chunk->fadeClock;
+    chunk->fadeClock = board->fadeClock;
+    int chunkMinX = (chunkIndex % board->chunkCountX) << BOARD_CHUNK_SHIFT;
+    int chunkMinY = (chunkIndex / board->chunkCountX) << BOARD_CHUNK_SHIFT;
+    for(int fadeIndex = 0; fadeIndex < chunk->fadingCount; ) {
+        int cellIndex = chunk->fadingCells[fadeIndex];
+        TimerReturnInfo timeInfo = updateTimer(&chunk->fadeTimers[cellIndex], dt);
+        if(timeInfo.finished) {
+            int x = chunkMinX + (cellIndex & (BOARD_CHUNK_SIZE - 1));
+            int y = chunkMinY + (cellIndex >> BOARD_CHUNK_SHIFT);
+            int boardIndex = y*game->boardWidth + x;
+            chunk->prevStates[cellIndex] = board->states[boardIndex];
+            //NOTE: a settled cell goes into the host's cached layer once it stops fading
+            if(isFilledState((BoardState)board->states[boardIndex])) {
+                setLayerRowChanged(&game->masks, y);
+            }
+
+            //swap the last one into this slot
+            chunk->fadingCells[fadeIndex] = chunk->fadingCells[--chunk->fadingCount];
+            chunk->fadeSlots[chunk->fadingCells[fadeIndex]] = fadeIndex;
+            chunk->fadeSlots[cellIndex] = -1;
+        } else {
+            fadeIndex++;
+        }
+    }
+}
+
+void setBoardState(GameState *game, V2 pos, BoardState state, BoardValType type) {
+    if(pos.x >= 0 && pos.x < game->boardWidth && pos.y >= 0 && pos.y < game->boardHeight) {
+        int boardIndex = getBoardIndex(game, pos);
+        BoardArrays *board = &game->board;
+        BoardChunk *chunk = getBoardChunk(game, (int)pos.x, (int)pos.y);
+        if(chunk->fadingCount == 0) {
+            chunk->fadeClock = board->fadeClock;
+        } else if(chunk->fadeClock != board->fadeClock) {
+            //NOTE: so the new fade doesn't get the time the chunk missed
+            updateChunkFades(game, getBoardChunkIndex(board, (int)pos.x, (int)pos.y));
+        }
+        int cellIndex = getChunkCellIndex((int)pos.x, (int)pos.y);
+        game->zobristHash ^= getZobristTypeKey(boardIndex, (BoardValType)board->types[boardIndex]) ^ getZobristTypeKey(boardIndex, type);
+        BoardState oldState = (BoardState)board->states[boardIndex];
+        chunk->prevStates[cellIndex] = oldState;
+        board->states[boardIndex] = state;
+        board->types[boardIndex] = type;
+        chunk->fadeTimers[cellIndex] = initTimer(FADE_TIMER_INTERVAL);
+        if(chunk->fadeSlots[cellIndex] < 0) {
+            chunk->fadeSlots[cellIndex] = chunk->fadingCount;
+            chunk->fadingCells[chunk->fadingCount++] = (u16)cellIndex;
+        }
+        setBoardMasks(game, pos, oldState, state);
+    } else {
+        assert(!"invalid code path");
+    }
+}
+
+/*
+    Moves the board's fadeClock on by dt and brings the fades of the chunks meeting cells up to it, so a frame only
+    costs the chunks on screen. The host calls this before drawing the board with the cells it draws, it doesn't
+    change the game. Which cells are fading (isCellFading, fadeTimers) is only up to date in the chunks it was given.
+*/
+void updateBoardFades(GameState *game, float dt, BoardCellRect cells) {
+    BoardArrays *board = &game->board;
+    board->fadeClock += dt;
+    if(cells.minX > cells.maxX || cells.minY > cells.maxY) {
+        return;
+    }
+    for(int chunkY = cells.minY >> BOARD_CHUNK_SHIFT; chunkY <= (cells.maxY >> BOARD_CHUNK_SHIFT); ++chunkY) {
+        for(int chunkX = cells.minX >> BOARD_CHUNK_SHIFT; chunkX <= (cells.maxX >> BOARD_CHUNK_SHIFT); ++chunkX) {
+            int chunkIndex = chunkY*board->chunkCountX + chunkX;
+            BoardChunk *chunk = board->chunks[chunkIndex];
+            if(chunk && chunk->fadingCount > 0) {
+                updateChunkFades(game, chunkIndex);
+            }
+        }
+    }
+}
+
+static inline bool isCellFading(GameState *game, int x, int y) {
+    BoardChunk *chunk = findBoardChunk(&game->board, x, y);
+    bool result = (chunk && chunk->fadeSlots[getChunkCellIndex(x, y)] >= 0);
+    return result;
+}
+
+void setBoardColor(GameState *game, V2 pos, V4 color) {
+    assert(inBoardBounds(game, pos));
+    BoardChunk *chunk = getBoardChunk(game, (int)pos.x, (int)pos.y);
+    V4 *cellColor = &chunk->colors[getChunkCellIndex((int)pos.x, (int)pos.y)];
+    if(isFilledState(getBoardState(game, pos)) && !v4Equal(*cellColor, color)) {
+        setLayerRowChanged(&game->masks, (int)pos.y);
+    }
+    *cellColor = color;
+}
+
+//NOTE: Call whenever a block of the shape is added, moved or removed. Only the game's currentShape is in the hash,
+//shapes made for testing aren't.
+static inline void toggleShapeZobrist(GameState *game, FitrisShape *shape, V2 pos) {
+    if(shape == &game->currentShape) {
+        game->zobristHash ^= getZobristShapeKey(getBoardIndex(game, pos));
+    }
+}
+
+static inline void scheduleExtraShape(GameState *game, int extraIndex, uint64_t fireTick) {
+    ExtraShape *shape = &game->extraShapes[extraIndex];
+    shape->eventIndex = scheduleTimerEvent(&game->timerWheel, fireTick, TIMER_EVENT_EXTRA_SHAPE, extraIndex);
+    shape->fireTick = game->timerWheel.events[shape->eventIndex].fireTick;
+}
+
+void addExtraShape(GameState *game, ExtraShapeType type, V2 pos) {
+    if(game->extraShapeCount == game->extraShapeCapacity) {
+        int newCapacity = (game->extraShapeCapacity > 0) ? 2*game->extraShapeCapacity : 8;
+        ExtraShape *extraShapes = pushArray(game->arena, newCapacity, ExtraShape);
+        memcpy(extraShapes, game->extraShapes, sizeof(ExtraShape)*game->extraShapeCount);
+        game->extraShapes = extraShapes;
+        game->extraShapeCapacity = newCapacity;
+    }
+    int extraIndex = game->extraShapeCount++;
+    ExtraShape *shape = game->extraShapes + extraIndex;
+    zeroStruct(shape, ExtraShape);
+    shape->type = type;
+
+    shape->pos = pos;
+
+    switch(type) {
+        case SHAPE_WINDMILL: {
+            setBoardState(game, shape->pos, BOARD_STATIC, BOARD_VAL_ALWAYS);
+            shape->periodTicks = TIMER_WHEEL_TICKS_PER_SECOND / 2;
+            shape->isOut = true;
+            shape->xMax = 3;
+            shape->yMax = 3;
+        } break;
+        default: {
+            assert(!"case not handled");
+        }
+    }
+    scheduleExtraShape(game, extraIndex, game->timerWheel.currentTick + shape->periodTicks);
+}
+
+#include "levelFile.h"
+
+void createLevel(GameState *game, int blockCount, LevelType levelType) {
+    LevelFile *levels = game->levels;
+    if(levels && levels->valid && levels->header.boardWidth == game->boardWidth && levels->header.boardHeight == game->boardHeight) {
+        int firstEntry = 0;
+        int entryCount = findLevelEntries(levels, levelType, blockCount, &firstEntry);
+        if(entryCount > 0) {
+            applyLevelEntry(game, levels, firstEntry + randomIndex(&game->random, entryCount));
+            return;
+        }
+    }
+
+    if(levelType == LEVEL_4) {
+        addExtraShape(game, SHAPE_WINDMILL, v2(2, 2));
+    }
+
+    for(int i = 0; i < blockCount && levelType != LEVEL_0 && levelType != LEVEL_4; ++i) {
+        V2 pos = {};
+        float rand1 = randomUnilateralInclusive(&game->random);
+        float rand2 = randomUnilateralInclusive(&game->random);
+        pos.x = lerp(0, rand1, (float)(game->boardWidth - 1));
+        pos.y = lerp(0, rand2, (float)(game->boardHeight - 5)); // so we don't block the shape creation
+
+        BoardState state = BOARD_NULL;
+        switch(levelType) {
+            case LEVEL_1: {
+                state = BOARD_STATIC;
+            } break;
+            case LEVEL_2: {
+                int type = (int)lerp(0, randomUnilateral(&game->random), 2);
+                if(type == 0) { state = BOARD_STATIC; }
+                if(type == 1) { state = BOARD_EXPLOSIVE; }
+            } break;
+            case LEVEL_3: {
+                state = BOARD_EXPLOSIVE;
+            } break;
+            default: {
+                assert(!"case not handled");
+            }
+        }
+
+        setBoardState(game, v2((int)pos.x, (int)pos.y), state, BOARD_VAL_ALWAYS);
+    }
+}
+
+V2 getMoveVec(MoveType moveType) {
+    V2 moveVec = v2(0, 0);
+    if(moveType == MOVE_LEFT) {
+        moveVec = v2(-1, 0);
+    } else  if(moveType == MOVE_RIGHT) {
+        moveVec = v2(1, 0);
+    } else  if(moveType == MOVE_DOWN) {
+        moveVec = v2(0, -1);
+    } else {
+        assert(!"not valid path");
+    }
+    return moveVec;
+}
+
+//NOTE: The shape as one 64 bit mask per row, relative to its bottom left corner.
+typedef struct {
+    int minX;
+    int minY;
+    int maxX;
+    int maxY;
+    uint64_t rows[MAX_SHAPE_COUNT];
+    bool fitsInMask; //false if the shape is wider than 64 or taller than MAX_SHAPE_COUNT (it got split up by an explosive)
+} ShapeRowMasks;
+
+ShapeRowMasks getShapeRowMasks(FitrisShape *shape) {
+    ShapeRowMasks result;
+    assert(shape->count > 0);
+    if(shape->mask) {
+        //NOTE: a catalogue shape already has its rows
+        const ShapeMask *mask = shape->mask;
+        result.minX = (int)shape->maskOrigin.x;
+        result.minY = (int)shape->maskOrigin.y;
+        result.maxX = result.minX + mask->width - 1;
+        result.maxY = result.minY + mask->height - 1;
+        result.fitsInMask = true;
+        for(int rowIndex = 0; rowIndex < mask->height; ++rowIndex) {
+            result.rows[rowIndex] = mask->rows[rowIndex];
+        }
+        return result;
+    }
+    int xs[MAX_SHAPE_COUNT];
+    int ys[MAX_SHAPE_COUNT];
+    result.minX = result.maxX = xs[0] = (int)shape->coords[0].x;
+    result.minY = result.maxY = ys[0] = (int)shape->coords[0].y;
+    for(int i = 1; i < shape->count; ++i) {
+        int x = xs[i] = (int)shape->coords[i].x;
+        int y = ys[i] = (int)shape->coords[i].y;
+        if(x < result.minX) { result.minX = x; }
+        if(x > result.maxX) { result.maxX = x; }
+        if(y < result.minY) { result.minY = y; }
+        if(y > result.maxY) { result.maxY = y; }
+    }
+
+    int rowCount = result.maxY - result.minY + 1;
+    result.fitsInMask = ((result.maxX - result.minX) < BOARD_MASK_WORD_BITS && rowCount <= MAX_SHAPE_COUNT);
+    if(result.fitsInMask) {
+        for(int rowIndex = 0; rowIndex < rowCount; ++rowIndex) {
+            result.rows[rowIndex] = 0;
+        }
+        for(int i = 0; i < shape->count; ++i) {
+            result.rows[ys[i] - result.minY] |= (uint64_t)1 << (xs[i] - result.minX);
+        }
+    }
+    return result;
+}
+
+//NOTE: The shape can move into anything but a STATIC block or off the board.
+bool canShapeMove(FitrisShape *shape, GameState *game, MoveType moveType) {
+    bool result = false;
+    if(shape->count > 0) { //every block could have been blown up
+        ShapeRowMasks shapeMasks = getShapeRowMasks(shape);
+        V2 moveVec = getMoveVec(moveType);
+        int moveX = (int)moveVec.x;
+        int moveY = (int)moveVec.y;
+
+        //Check shape won't move off the board//
+        result = (shapeMasks.minX + moveX >= 0 && shapeMasks.maxX + moveX < game->boardWidth &&
+                  shapeMasks.minY + moveY >= 0 && shapeMasks.maxY + moveY < game->boardHeight);
+
+        BoardMasks *masks = &game->masks;
+        if(result && shapeMasks.fitsInMask) {
+            for(int rowIndex = 0; rowIndex <= (shapeMasks.maxY - shapeMasks.minY); ++rowIndex) {
+                int boardY = shapeMasks.minY + rowIndex + moveY;
+                uint64_t boardBits = getMaskRowBits(masks, masks->staticRows, boardY, shapeMasks.minX + moveX);
+                if(shapeMasks.rows[rowIndex] & boardBits) {
+                    result = false;
+                    break;
+                }
+            }
+        } else if(result) {
+            for(int i = 0; i < shape->count; ++i) {
+                V2 pos = v2_plus(shape->coords[i], moveVec);
+                if(getMaskBit(masks, masks->staticRows, (int)pos.x, (int)pos.y)) {
+                    result = false;
+                    break;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+bool isInShape(FitrisShape *shape, V2 pos) {
+    bool result = false;
+    for(int i = 0; i < shape->count; ++i) {
+      V2 shapePos = shape->coords[i];
+      if(pos.x == shapePos.x && pos.y == shapePos.y) {
+        result = true;
+        break;
+      }
+   }
+   return result;
+}
+
+typedef struct {
+    bool result;
+    int index;
+} QueryShapeInfo;
+
+QueryShapeInfo isRepeatedInShape(FitrisShape *shape, V2 pos, int index) {
+    QueryShapeInfo result = {};
+    for(int i = 0; i < shape->count; ++i) {
+      V2 shapePos = shape->coords[i];
+      if(i != index && pos.x == shapePos.x && pos.y == shapePos.y) {
+        result.result = true;
+        result.index = i;
+        assert(i != index);
+        break;
+      }
+   }
+   return result;
+}
+
+bool moveShape(FitrisShape *shape, GameState *game, MoveType moveType) {
+    bool result = canShapeMove(shape, game, moveType);
+    if(result) {
+        V2 moveVec = getMoveVec(moveType);
+
+        assert(!game->wasHitByExplosive);
+       // CHECK FOR EXPLOSIVES HIT
+        int indexesHitCount = 0;
+        int indexesHit[MAX_SHAPE_COUNT] = {};
+        for(int i = 0; i < shape->count; ++i) {
+          V2 oldPos = shape->coords[i];
+          V2 newPos = v2_plus(oldPos, moveVec);
+          BoardState state = getBoardState(game, newPos);
+          if(state == BOARD_EXPLOSIVE) {
+            game->lifePoints--;
+            game->stats.explosivesHit++;
+            game->wasHitByExplosive = true;
+            pushGameEvent(&game->events, GAME_EVENT_EXPLODED, newPos, 0);
+            //remove from shapea
+            assert(indexesHitCount < arrayCount(indexesHit));
+            indexesHit[indexesHitCount++] = i;
+            setBoardState(game, oldPos, BOARD_NULL, BOARD_VAL_TRANSIENT);
+            setBoardState(game, newPos, BOARD_NULL, BOARD_VAL_TRANSIENT);
+          }
+        }
+
+        //NOTE: go backwards so swapping the last block into the hole never moves a block we still have to remove
+        for(int hitIndex = indexesHitCount - 1; hitIndex >= 0; --hitIndex) {
+            int indexAt = indexesHit[hitIndex];
+            toggleShapeZobrist(game, shape, shape->coords[indexAt]);
+            shape->coords[indexAt] = shape->coords[--shape->count];
+        }
+        if(indexesHitCount > 0) {
+            shape->mask = 0;
+        }
+        shape->maskOrigin = v2_plus(shape->maskOrigin, moveVec);
+
+       for(int i = 0; i < shape->count; ++i) {
+            V2 oldPos = shape->coords[i];
+            V2 newPos = v2_plus(oldPos, moveVec);
+
+            assert(getBoardState(game, oldPos) == BOARD_SHAPE);
+            BoardState newPosState = getBoardState(game, newPos);
+            assert(newPosState == BOARD_SHAPE || newPosState == BOARD_NULL);
+
+            QueryShapeInfo info = isRepeatedInShape(shape, oldPos, i);
+            if(!info.result) { //dind't just get set by the block in shape before.
+                setBoardState(game, oldPos, BOARD_NULL, BOARD_VAL_TRANSIENT);
+            }
+            setBoardState(game, newPos, BOARD_SHAPE, BOARD_VAL_TRANSIENT);
+            toggleShapeZobrist(game, shape, oldPos);
+            toggleShapeZobrist(game, shape, newPos);
+            shape->coords[i] = newPos;
+        }
+        pushGameEvent(&game->events, GAME_EVENT_MOVED, moveVec, 0);
+    }
+    return result;
+}
+
+void solidfyShape(FitrisShape *shape, GameState *game) {
+    for(int i = 0; i < shape->count; ++i) {
+        V2 pos = shape->coords[i];
+        if(getBoardState(game, pos) == BOARD_SHAPE) {
+            setBoardState(game, pos, BOARD_STATIC, BOARD_VAL_OLD);
+        }
+        setBoardColor(game, pos, COLOR_WHITE);
+
+    }
+    pushGameEvent(&game->events, GAME_EVENT_SOLIDIFIED, v2(0, 0), shape->count);
+}
+
+//NOTE: True if the mask with its bottom left at origin is on the board and misses every STATIC & EXPLOSIVE cell, and
+//every SHAPE cell too if shapesBlock.
+bool canPlaceShapeMask(GameState *game, const ShapeMask *mask, int originX, int originY, bool shapesBlock) {
+    bool result = (originX >= 0 && originX + mask->width <= game->boardWidth &&
+                   originY >= 0 && originY + mask->height <= game->boardHeight);
+    BoardMasks *masks = &game->masks;
+    for(int rowIndex = 0; rowIndex < mask->height && result; ++rowIndex) {
+        int boardY = originY + rowIndex;
+        uint64_t boardBits = getMaskRowBits(masks, masks->staticRows, boardY, originX) |
+                             getMaskRowBits(masks, masks->explosiveRows, boardY, originX);
+        if(shapesBlock) {
+            boardBits |= getMaskRowBits(masks, masks->shapeRows, boardY, originX);
+        }
+        result = !(mask->rows[rowIndex] & boardBits);
+    }
+    return result;
+}
+
+/*
+    Adds the mask's blocks to the shape's coords and puts them on the board, top row first, left to right. If the
+    mask test said something is in the way (blocked) each cell is looked at, and it stops at the first one that
+    isn't empty, leaving that one as the last coord. Returns false when it stopped.
+*/
+bool putShapeMask(GameState *game, FitrisShape *shape, const ShapeMask *mask, int originX, int originY, bool blocked) {
+    for(int rowIndex = mask->height - 1; rowIndex >= 0; --rowIndex) {
+        uint64_t bits = mask->rows[rowIndex];
+        while(bits) {
+            V2 pos = v2(originX + countTrailingZeros64(bits), originY + rowIndex);
+            bits &= bits - 1;
+            if(blocked && !inBoardBounds(game, pos)) {
+                return false;
+            }
+            shape->coords[shape->count++] = pos;
+            toggleShapeZobrist(game, shape, pos);
+            if(blocked && getBoardState(game, pos) != BOARD_NULL) {
+                return false;
+            }
+            setBoardState(game, pos, BOARD_SHAPE, BOARD_VAL_TRANSIENT);
+        }
+    }
+    return true;
+}
+
+//NOTE: A new shape from the catalogue against the top left of the board. The shape has to be empty. Returns false if
+//the board is in the way, the game is then lost.
+bool spawnShape(GameState *game, FitrisShape *shape) {
+    assert(shape->count == 0);
+    int catalogueIndex = pickSpawnShape(game->shapes, &game->random);
+    const ShapeMask *mask = &game->shapes->shapes[catalogueIndex].rotations[0];
+    int originX = 0;
+    int originY = game->boardHeight - mask->height;
+
+    shape->mask = mask;
+    shape->maskOrigin = v2(originX, originY);
+    shape->catalogueIndex = catalogueIndex;
+    shape->rotation = 0;
+
+    bool blocked = !canPlaceShapeMask(game, mask, originX, originY, true);
+    bool result = putShapeMask(game, shape, mask, originX, originY, blocked);
+    return result;
+}
+
+//NOTE: A quarter turn clockwise about the middle of the shape, a column over either way if that is what it takes to
+//fit. Only a shape that still matches its catalogue mask can turn.
+bool rotateShape(FitrisShape *shape, GameState *game) {
+    bool result = false;
+    if(shape->mask && shape->count > 0) {
+        const CatalogueShape *catalogueShape = &game->shapes->shapes[shape->catalogueIndex];
+        int rotation = (shape->rotation + 1) % catalogueShape->rotationCount;
+        const ShapeMask *mask = &catalogueShape->rotations[rotation];
+        int originX = (int)shape->maskOrigin.x + (shape->mask->width - mask->width) / 2;
+        int originY = (int)shape->maskOrigin.y + (shape->mask->height - mask->height) / 2;
+        int kicks[] = {0, -1, 1};
+        for(int kickIndex = 0; kickIndex < arrayCount(kicks) && !result && rotation != shape->rotation; ++kickIndex) {
+            result = canPlaceShapeMask(game, mask, originX + kicks[kickIndex], originY, false);
+            if(result) {
+                originX += kicks[kickIndex];
+            }
+        }
+        if(result) {
+            for(int i = 0; i < shape->count; ++i) {
+                setBoardState(game, shape->coords[i], BOARD_NULL, BOARD_VAL_TRANSIENT);
+                toggleShapeZobrist(game, shape, shape->coords[i]);
+            }
+            shape->count = 0;
+            putShapeMask(game, shape, mask, originX, originY, false);
+            shape->mask = mask;
+            shape->maskOrigin = v2(originX, originY);
+            shape->rotation = rotation;
+            pushGameEvent(&game->events, GAME_EVENT_MOVED, v2(0, 0), 1);
+        }
+    }
+    return result;
+}
+
+/*
+    The blocks of the shape as a small graph, so checking if the shape is still in one piece only looks at the
+    MAX_SHAPE_COUNT blocks and never at the board. Islands are bit sets of block indexes.
+*/
+typedef struct {
+    int count;
+    V2 poses[MAX_SHAPE_COUNT];
+    uint32_t neighbours[MAX_SHAPE_COUNT]; //bit j is set when block j is next to this block
+} ShapeGraph;
+
+//NOTE: The cells next to a block, in the order the old flood fill looked at them (right, left, up, down).
+static V2 shapeNeighbourOffsets[] = {
+    {1, 0}, {-1, 0}, {0, 1}, {0, -1},
+#if CAN_ALTER_SHAPE_DIAGONAL
+    {1, 1}, {-1, 1}, {-1, -1}, {1, -1},
+#endif
+};
+
+static inline bool areBlocksNextTo(V2 a, V2 b) {
+    int dx = abs((int)a.x - (int)b.x);
+    int dy = abs((int)a.y - (int)b.y);
+#if CAN_ALTER_SHAPE_DIAGONAL
+    bool result = (dx <= 1 && dy <= 1 && (dx + dy) > 0);
+#else
+    bool result = (dx + dy == 1);
+#endif
+    return result;
+}
+
+//NOTE: Moves one block and fixes up the neighbours of it and the blocks around it.
+void moveShapeGraphBlock(ShapeGraph *graph, int index, V2 pos) {
+    graph->poses[index] = pos;
+    uint32_t bit = (uint32_t)1 << index;
+    graph->neighbours[index] = 0;
+    for(int i = 0; i < graph->count; ++i) {
+        if(i != index && areBlocksNextTo(graph->poses[i], pos)) {
+            graph->neighbours[i] |= bit;
+            graph->neighbours[index] |= (uint32_t)1 << i;
+        } else {
+            graph->neighbours[i] &= ~bit;
+        }
+    }
+}
+
+//NOTE: Works out the neighbours of every block from graph->poses.
+void buildShapeGraphNeighbours(ShapeGraph *graph) {
+    for(int i = 0; i < graph->count; ++i) {
+        graph->neighbours[i] = 0;
+        for(int j = 0; j < i; ++j) {
+            if(areBlocksNextTo(graph->poses[i], graph->poses[j])) {
+                graph->neighbours[i] |= (uint32_t)1 << j;
+                graph->neighbours[j] |= (uint32_t)1 << i;
+            }
+        }
+    }
+}
+
+//NOTE: Returns the graph index of the shape block at shapeIndex.
+int initShapeGraph(ShapeGraph *graph, FitrisShape *shape, GameState *game, int shapeIndex) {
+    int result = -1;
+    graph->count = 0;
+    for(int i = 0; i < shape->count; ++i) {
+        V2 pos = shape->coords[i];
+        if(getBoardState(game, pos) == BOARD_SHAPE) {
+            if(i == shapeIndex) {
+                result = graph->count;
+            }
+            graph->poses[graph->count++] = pos;
+        }
+    }
+    buildShapeGraphNeighbours(graph);
+    return result;
+}
+
+uint32_t getShapeIsland(ShapeGraph *graph, int startIndex) {
+    uint32_t island = (uint32_t)1 << startIndex;
+    uint32_t frontier = island;
+    while(frontier) {
+        uint32_t next = 0;
+        while(frontier) {
+            int index = countTrailingZeros64(frontier);
+            frontier &= frontier - 1;
+            next |= graph->neighbours[index];
+        }
+        frontier = next & ~island;
+        island |= frontier;
+    }
+    return island;
+}
+
+//NOTE: The first block next to startIndex, looking in shapeNeighbourOffsets order.
+int getFirstShapeNeighbour(ShapeGraph *graph, int startIndex) {
+    int result = -1;
+    V2 startPos = graph->poses[startIndex];
+    for(int offsetIndex = 0; offsetIndex < arrayCount(shapeNeighbourOffsets) && result < 0; ++offsetIndex) {
+        V2 pos = v2_plus(startPos, shapeNeighbourOffsets[offsetIndex]);
+        for(int i = 0; i < graph->count; ++i) {
+            if(graph->poses[i].x == pos.x && graph->poses[i].y == pos.y) {
+                result = i;
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+//NOTE: The held block can only go to an empty cell that isn't part of the shape.
+static inline bool isDragTargetFree(FitrisShape *shape, V2 boardPosAt, GameState *game) {
+    bool result = (getBoardState(game, boardPosAt) == BOARD_NULL);
+    for(int i = 0; i < shape->count && result; ++i) {
+        V2 pos = shape->coords[i];
+        if(boardPosAt.x == pos.x && boardPosAt.y == pos.y) {
+            result = false;
+        }
+    }
+    return result;
+}
+
+typedef struct {
+    ShapeGraph graph;
+    int hotIndex; //graph index of the held block
+    int keepIndex; //graph index of a block that has to still be with the held block after it moves
+    uint32_t mainIsland;
+    int mainIslandCount;
+} HeldBlockGraph;
+
+//NOTE: held->graph has to be filled out already. Returns false if the held block is on its own island, then it can't be moved anywhere.
+bool initHeldBlockFromGraph(HeldBlockGraph *held, int hotIndex) {
+    held->hotIndex = hotIndex;
+
+    //NOTE: This is since shape can be blown apart we want to still be able to move a block on their
+    //own island. So we first find the island the block is on and match against that.
+    held->mainIsland = getShapeIsland(&held->graph, held->hotIndex);
+    held->mainIslandCount = countSetBits64(held->mainIsland);
+    held->keepIndex = -1;
+
+    bool result = (held->mainIslandCount > 1);
+    if(result) {
+        held->keepIndex = getFirstShapeNeighbour(&held->graph, held->hotIndex);
+        assert(held->keepIndex >= 0 && held->keepIndex != held->hotIndex);
+    }
+    return result;
+}
+
+//NOTE: Returns false if the held block is on its own island, then it can't be moved anywhere.
+bool initHeldBlockGraph(HeldBlockGraph *held, FitrisShape *shape, int currentHotIndex, GameState *game) {
+    assert(getBoardState(game, shape->coords[currentHotIndex]) == BOARD_SHAPE);
+
+    int hotIndex = initShapeGraph(&held->graph, shape, game, currentHotIndex);
+    assert(hotIndex >= 0);
+    bool result = initHeldBlockFromGraph(held, hotIndex);
+    return result;
+}
+
+bool canMoveHeldBlock(HeldBlockGraph *held, V2 boardPosAt) {
+    V2 oldPos = held->graph.poses[held->hotIndex];
+    moveShapeGraphBlock(&held->graph, held->hotIndex, boardPosAt);
+    uint32_t island = getShapeIsland(&held->graph, held->hotIndex);
+    bool result = (countSetBits64(island) == held->mainIslandCount && (island & ((uint32_t)1 << held->keepIndex)));
+    moveShapeGraphBlock(&held->graph, held->hotIndex, oldPos);
+    return result;
+}
+
+bool shapeStillConnected(FitrisShape *shape, int currentHotIndex, V2 boardPosAt, GameState *game) {
+    bool result = false;
+    if(isDragTargetFree(shape, boardPosAt, game)) {
+        HeldBlockGraph held;
+        if(initHeldBlockGraph(&held, shape, currentHotIndex, game)) {
+            result = canMoveHeldBlock(&held, boardPosAt);
+        }
+    }
+    return result;
+}
+
+/*
+    The held block has to end up next to another block of its island, so only the cells around the island are tried.
+*/
+void updateDragTargetMap(GameState *game, FitrisShape *shape) {
+    DragTargetMap *map = &game->dragTargets;
+    if(map->valid && map->hotIndex == game->currentHotIndex && map->boardChangeCount == game->boardChangeCount) {
+        return;
+    }
+    zeroStruct(map, DragTargetMap);
+    map->valid = true;
+    map->hotIndex = game->currentHotIndex;
+    map->boardChangeCount = game->boardChangeCount;
+
+    HeldBlockGraph held;
+    if(game->currentHotIndex >= 0 && initHeldBlockGraph(&held, shape, game->currentHotIndex, game)) {
+        V2 hotPos = held.graph.poses[held.hotIndex];
+        int minX = (int)hotPos.x;
+        int minY = (int)hotPos.y;
+        int maxX = minX;
+        int maxY = minY;
+        for(uint32_t bits = held.mainIsland; bits; bits &= bits - 1) {
+            V2 pos = held.graph.poses[countTrailingZeros64(bits)];
+            if((int)pos.x < minX) { minX = (int)pos.x; }
+            if((int)pos.y < minY) { minY = (int)pos.y; }
+            if((int)pos.x > maxX) { maxX = (int)pos.x; }
+            if((int)pos.y > maxY) { maxY = (int)pos.y; }
+        }
+        map->minX = minX - 1;
+        map->minY = minY - 1;
+        assert((maxX + 1) - map->minX < 32 && (maxY + 1) - map->minY < DRAG_TARGET_MAP_SIZE);
+
+        uint32_t tried[DRAG_TARGET_MAP_SIZE] = {};
+        uint32_t otherBlocks = held.mainIsland & ~((uint32_t)1 << held.hotIndex);
+        for(uint32_t bits = otherBlocks; bits; bits &= bits - 1) {
+            V2 blockPos = held.graph.poses[countTrailingZeros64(bits)];
+            for(int offsetIndex = 0; offsetIndex < arrayCount(shapeNeighbourOffsets); ++offsetIndex) {
+                V2 pos = v2_plus(blockPos, shapeNeighbourOffsets[offsetIndex]);
+                int mapX = (int)pos.x - map->minX;
+                int mapY = (int)pos.y - map->minY;
+                uint32_t bit = (uint32_t)1 << mapX;
+                if(!(tried[mapY] & bit)) {
+                    tried[mapY] |= bit;
+                    if(isDragTargetFree(shape, pos, game) && canMoveHeldBlock(&held, pos)) {
+                        map->rows[mapY] |= bit;
+                    }
+                }
+            }
+        }
+    }
+}
+
+//NOTE: Call updateDragTargetMap first.
+static inline bool isDragTarget(GameState *game, V2 boardPos) {
+    DragTargetMap *map = &game->dragTargets;
+    assert(map->valid && map->boardChangeCount == game->boardChangeCount);
+    int mapX = (int)boardPos.x - map->minX;
+    int mapY = (int)boardPos.y - map->minY;
+    bool result = false;
+    if(mapX >= 0 && mapX < 32 && mapY >= 0 && mapY < DRAG_TARGET_MAP_SIZE) {
+        result = (map->rows[mapY] >> mapX) & 1;
+    }
+    return result;
+}
+
+void resetMouseUI(GameState *game) {
+    game->currentHotIndex = -1; //reset hot ui
+    game->slowTimeFactor = 1;
+}
+
+void updateShape(FitrisShape *shape, GameState *game, GameInput *input, float dt) {
+    assert(!game->wasHitByExplosive);
+    assert(!game->createShape);
+    GameButton *buttons = input->buttons;
+#if CAN_MOVE_WITH_ARROW_KEYS
+    bool areRearranging = (game->currentHotIndex >= 0);
+    if(wasPressed(buttons, BUTTON_LEFT) && !areRearranging) {
+        moveShape(shape, game, MOVE_LEFT);
+    }
+    if(wasPressed(buttons, BUTTON_RIGHT) && !areRearranging) {
+        moveShape(shape, game, MOVE_RIGHT);
+    }
+    if(wasPressed(buttons, BUTTON_DOWN) && !areRearranging) {
+        if(moveShape(shape, game, MOVE_DOWN)) {
+            game->moveTimer.value = 0;
+        }
+    }
+    if(wasPressed(buttons, BUTTON_UP) && !areRearranging) {
+        rotateShape(shape, game);
+    }
+#endif
+
+    if(wasReleased(buttons, BUTTON_LEFT_MOUSE)) {
+        resetMouseUI(game);
+    }
+
+    bool turnSolid = false;
+    TimerReturnInfo timerInfo = updateTimer(&game->moveTimer, game->slowTimeFactor*dt);
+    if(timerInfo.finished) {
+        turnTimerOn(&game->moveTimer);
+        if(!moveShape(shape, game, MOVE_DOWN)) {
+            turnSolid = true;
+        }
+    }
+    game->wasHitByExplosive = false;
+    if(turnSolid) {// || game->wasHitByExplosive
+        solidfyShape(shape, game);
+        game->createShape = true;
+        game->wasHitByExplosive = false;
+        resetMouseUI(game);
+    } else {
+
+        int hotBlockIndex = -1;
+        for(int i = 0; i < shape->count; ++i) {
+            V2 *pos = shape->coords +i;
+
+            Rect2f blockBounds = rect2fCenterDimV2(*pos, v2(1, 1));
+
+            V4 color = COLOR_WHITE;
+
+            if(inBounds(input->mouseBoardP, blockBounds, BOUNDS_RECT)) {
+                hotBlockIndex = i;
+                if(game->currentHotIndex < 0) {
+                    color = COLOR_YELLOW;
+                }
+            }
+            if(game->currentHotIndex == i) {
+                assert(isDown(buttons, BUTTON_LEFT_MOUSE));
+                color = COLOR_GREEN;
+            }
+            setBoardColor(game, *pos, color);
+        }
+
+        if(wasPressed(buttons, BUTTON_LEFT_MOUSE) && hotBlockIndex >= 0) {
+            game->currentHotIndex = hotBlockIndex;
+            game->slowTimeFactor = 0.0f;  //don't move block if we are rearranging
+        }
+
+        if(game->currentHotIndex >= 0) {
+            //We are holding onto a block
+            V2 boardPosAt = input->mouseBoardP;
+            boardPosAt.x = (int)(clamp(0, boardPosAt.x, game->boardWidth - 1) + 0.5f);
+            boardPosAt.y = (int)(clamp(0, boardPosAt.y, game->boardHeight -1) + 0.5f);
+
+            updateDragTargetMap(game, shape);
+            if(isDragTarget(game, boardPosAt)) {
+                V2 oldPos = shape->coords[game->currentHotIndex];
+                V2 newPos = boardPosAt;
+                assert(getBoardState(game, oldPos) == BOARD_SHAPE);
+                setBoardState(game, oldPos, BOARD_NULL, BOARD_VAL_TRANSIENT);
+                setBoardState(game, newPos, BOARD_SHAPE, BOARD_VAL_TRANSIENT);
+                toggleShapeZobrist(game, shape, oldPos);
+                toggleShapeZobrist(game, shape, newPos);
+                shape->coords[game->currentHotIndex] = newPos;
+                shape->mask = 0;
+            }
+        }
+
+    }
+}
+
+//NOTE: Only looks at the rows whose filled count changed since last frame. Goes through them bottom to top, the same
+//order a scan of the whole board would.
+void updateBoardWinState(GameState *game) {
+    BoardMasks *masks = &game->masks;
+    int winCount = 0;
+    for(int dirtyWordIndex = 0; dirtyWordIndex < masks->dirtyWordCount; ++dirtyWordIndex) {
+        uint64_t dirtyBits = masks->dirtyRows[dirtyWordIndex];
+        masks->dirtyRows[dirtyWordIndex] = 0;
+        while(dirtyBits) {
+            int boardY = dirtyWordIndex*BOARD_MASK_WORD_BITS + countTrailingZeros64(dirtyBits);
+            dirtyBits &= dirtyBits - 1;
+            assert(isRowFull(masks, boardY) == isMaskRowFull(masks, boardY));
+            if(isRowFull(masks, boardY)) {
+                winCount++;
+                //clear the blocks the player put there, leave the ones that are part of the level
+                uint64_t *staticRow = getMaskRow(masks, masks->staticRows, boardY);
+                for(int wordIndex = 0; wordIndex < masks->wordsPerRow; ++wordIndex) {
+                    uint64_t bits = staticRow[wordIndex];
+                    while(bits) {
+                        int boardX = wordIndex*BOARD_MASK_WORD_BITS + countTrailingZeros64(bits);
+                        bits &= bits - 1;
+                        if(game->board.types[boardY*game->boardWidth + boardX] == BOARD_VAL_OLD) {
+                            setBoardState(game, v2(boardX, boardY), BOARD_NULL, BOARD_VAL_OLD);
+                        }
+                    }
+                }
+                //NOTE: a row filled only by level blocks stays full, keep checking it like the full scan did
+                if(isRowFull(masks, boardY)) {
+                    setRowDirty(masks, boardY);
+                }
+                pushGameEvent(&game->events, GAME_EVENT_ROW_CLEARED, v2(0, boardY), boardY);
+            }
+        }
+    }
+    game->experiencePoints += sqr(winCount)*100;
+    game->stats.linesCleared += winCount;
+}
+
+void initBoard(Arena *longTermArena, GameState *game, int boardWidth, int boardHeight, LevelType levelType, int blockCount, bool createArray) {
+    game->boardWidth = boardWidth;
+    game->boardHeight = boardHeight;
+
+    game->lifePoints = game->lifePointsMax;
+    if(createArray) {
+        initBoardArrays(longTermArena, &game->board, game->boardWidth, game->boardHeight);
+        initBoardMasks(longTermArena, &game->masks, game->boardWidth, game->boardHeight);
+        initTimerWheel(&game->timerWheel, longTermArena);
+    }
+    assert(game->masks.width == game->boardWidth && game->masks.height == game->boardHeight);
+    clearBoardMasks(&game->masks);
+
+    BoardArrays *board = &game->board;
+    int cellCount = game->boardWidth*game->boardHeight;
+    memset(board->types, BOARD_VAL_NULL, cellCount);
+    memset(board->states, BOARD_NULL, cellCount);
+    //NOTE: the chunks stay made, they are only emptied
+    for(int usedIndex = 0; usedIndex < board->usedChunkCount; ++usedIndex) {
+        resetBoardChunk(board->chunks[board->usedChunks[usedIndex]]);
+    }
+
+    //NOTE: the board is empty so only the shape is left in the hash
+    game->zobristHash = 0;
+    for(int i = 0; i < game->currentShape.count; ++i) {
+        toggleShapeZobrist(game, &game->currentShape, game->currentShape.coords[i]);
+    }
+    //NOTE: the windmills are part of the level, so clear them otherwise retrying LEVEL_4 stacks another one on top.
+    game->extraShapeCount = 0;
+    clearTimerWheel(&game->timerWheel);
+
+    createLevel(game, blockCount, levelType);
+}
+
+//NOTE: The Zobrist hash worked out from the whole board. Should always match getZobristHash, used to check the
+//incremental updates.
+uint64_t computeZobristHash(GameState *game) {
+    uint64_t hash = 0;
+    int cellCount = game->boardWidth*game->boardHeight;
+    for(int boardIndex = 0; boardIndex < cellCount; ++boardIndex) {
+        hash ^= getZobristStateKey(boardIndex, (BoardState)game->board.states[boardIndex]);
+        hash ^= getZobristTypeKey(boardIndex, (BoardValType)game->board.types[boardIndex]);
+    }
+    for(int i = 0; i < game->currentShape.count; ++i) {
+        hash ^= getZobristShapeKey(getBoardIndex(game, game->currentShape.coords[i]));
+    }
+    return hash;
+}
+
+//NOTE: FNV-1a of the board states and the player's score & lives. What replays compare at the end.
+uint64_t getGameHash(GameState *game) {
+    uint64_t hash = 14695981039346656037ULL;
+    int cellCount = game->boardWidth*game->boardHeight;
+    for(int boardIndex = 0; boardIndex < cellCount; ++boardIndex) {
+        hash = (hash ^ (uint8_t)game->board.states[boardIndex])*1099511628211ULL;
+    }
+    hash = (hash ^ (uint32_t)game->experiencePoints)*1099511628211ULL;
+    hash = (hash ^ (uint32_t)game->lifePoints)*1099511628211ULL;
+    return hash;
+}
+
+//NOTE: A copy of the game with its own board arrays pushed on arena, so it can be stepped without changing src.
+//The events aren't copied.
+void cloneGameState(GameState *dest, GameState *src, Arena *arena) {
+    *dest = *src;
+    dest->arena = arena;
+    clearGameEvents(&dest->events);
+    dest->undo = 0;
+    dest->dragTargets.valid = false;
+
+    int cellCount = src->boardWidth*src->boardHeight;
+    BoardArrays *board = &dest->board;
+    initBoardArrays(arena, board, src->boardWidth, src->boardHeight);
+    memcpy(board->states, src->board.states, sizeof(u8)*cellCount);
+    memcpy(board->types, src->board.types, sizeof(u8)*cellCount);
+    for(int usedIndex = 0; usedIndex < src->board.usedChunkCount; ++usedIndex) {
+        int chunkIndex = src->board.usedChunks[usedIndex];
+        board->chunks[chunkIndex] = pushStruct(arena, BoardChunk);
+        memcpy(board->chunks[chunkIndex], src->board.chunks[chunkIndex], sizeof(BoardChunk));
+        board->usedChunks[board->usedChunkCount++] = chunkIndex;
+    }
+    board->fadeClock = src->board.fadeClock;
+
+    initBoardMasks(arena, &dest->masks, src->boardWidth, src->boardHeight);
+    copyBoardMasks(&dest->masks, &src->masks);
+
+    dest->extraShapes = pushArray(arena, src->extraShapeCapacity, ExtraShape);
+    memcpy(dest->extraShapes, src->extraShapes, sizeof(ExtraShape)*src->extraShapeCount);
+    copyTimerWheel(&dest->timerWheel, &src->timerWheel, arena);
+}
+
+//NOTE: Sets up a new game. The host reads what happens from game->events.
+void initGame(GameState *game, Arena *arena, int boardWidth, int boardHeight, LevelType levelType, int blockCount, RandomSeries random) {
+    game->arena = arena;
+    game->random = random;
+    game->slowTimeFactor = 1.0f;
+    game->experiencePoints = 100;
+    game->lifePointsMax = 3;
+    game->currentHotIndex = -1;
+    game->currentBlockCount = blockCount;
+    game->currentLevelType = levelType;
+    if(!game->shapes) {
+        game->shapes = &defaultShapeCatalogue;
+    }
+    initBoard(arena, game, boardWidth, boardHeight, levelType, blockCount, true);
+    game->createShape = true;
+    game->moveTimer = initTimer(1.0f);
+}
+
+#include "boardSnapshot.h"
+
+//NOTE: what the level transition calls at the half way point. Headless hosts call it straight away.
+void restartLevel(GameState *game, LevelType levelType, int blockCount) {
+    initBoard(game->arena, game, game->boardWidth, game->boardHeight, levelType, blockCount, false);
+    if(game->undo) {
+        clearUndoRing(game->undo);
+    }
+    game->createShape = true;
+    game->retryLevel = false;
+    game->lifePoints = game->lifePointsMax;
+    resetMouseUI(game);
+}
+
+void updateWindmillSide(GameState *game, V2 pos, int max, int *count_, bool *isOut_, bool *axis_) {
+    int count = *count_;
+    bool isOut = *isOut_;
+    bool axis = *axis_;
+
+    V2 shift = v2(0, 0);
+    BoardState stateToSet = BOARD_NULL;
+    if(isOut) {
+        count++;
+        if(axis) { shift = v2(count, 0); } //is xAxis
+        if(!axis) { shift = v2(0, count); } //is xyAxis
+        stateToSet = BOARD_STATIC;
+    } else {
+        if(axis) { shift = v2(count, 0); } //is xAxis
+        if(!axis) { shift = v2(0, count); } //is xAxis
+        count--;
+    }
+
+    V2 newPos = v2_plus(pos, shift);
+
+    if(getBoardState(game, newPos) != BOARD_NULL && stateToSet == BOARD_STATIC) {
+        isOut = false;
+    }
+    if(inBoardBounds(game, newPos)) {
+        if((getBoardState(game, newPos) == BOARD_NULL && stateToSet == BOARD_STATIC) || stateToSet == BOARD_NULL) {
+            setBoardState(game, newPos, stateToSet, BOARD_VAL_ALWAYS);
+        } else {
+            //blocked so we never put an arm here, don't clear whatever is there on the way back in
+            count--;
+        }
+    } else {
+        isOut = false;
+        count--;
+    }
+
+    if(count == max) {
+        isOut = false;
+    }
+    if(count == 0) {
+        axis = !axis;
+        isOut = true;
+        count = 0;
+    }
+    *count_ = count;
+    *axis_ = axis;
+    *isOut_ = isOut;
+}
+
+//NOTE: Only the extra shapes whose time came up this frame, in the order they came up.
+void updateExtraShapes(GameState *game, float dt) {
+    TimerWheel *wheel = &game->timerWheel;
+    advanceTimerWheel(wheel, getTimerWheelTicks(wheel, dt));
+    for(int firedIndex = 0; firedIndex < wheel->firedCount; ++firedIndex) {
+        TimerEvent *event = &wheel->fired[firedIndex];
+        assert(event->type == TIMER_EVENT_EXTRA_SHAPE && event->data < game->extraShapeCount);
+        int extraIndex = event->data;
+        ExtraShape *extraShape = game->extraShapes + extraIndex;
+        switch(extraShape->type) {
+            case SHAPE_WINDMILL: {
+                if(extraShape->onX) {
+                    updateWindmillSide(game, extraShape->pos, extraShape->xMax, &extraShape->count, &extraShape->isOut, &extraShape->onX);
+                } else {
+                    updateWindmillSide(game, extraShape->pos, extraShape->yMax, &extraShape->count, &extraShape->isOut, &extraShape->onX);
+                }
+            } break;
+        }
+        //NOTE: from now, not from when it was due, the same as turning a timer back on
+        scheduleExtraShape(game, extraIndex, wheel->currentTick + extraShape->periodTicks);
+    }
+}
+
+//NOTE: One frame of game logic. Returns early with retryLevel set if the shape can't spawn or we have no lives left.
+void stepGame(GameState *game, GameInput *input, float dt) {
+    if(game->retryLevel) {
+        return; //waiting on the host to call restartLevel
+    }
+
+    if(game->undo && wasPressed(input->buttons, BUTTON_Z)) {
+        undoBoardSnapshot(game->undo, game);
+    }
+
+    if(game->createShape || !game->lifePoints) {
+        for(int i = 0; i < game->currentShape.count; ++i) {
+            toggleShapeZobrist(game, &game->currentShape, game->currentShape.coords[i]);
+        }
+        game->currentShape.count = 0;
+        bool retryLevel = !game->lifePoints;
+        if(!retryLevel) {
+            //at the top of the board
+            retryLevel = !spawnShape(game, &game->currentShape);
+        }
+
+        game->moveTimer.value = 0;
+        game->createShape = false;
+
+        if(retryLevel) {
+            game->retryLevel = true;
+            game->stats.levelsFailed++;
+            return;
+        }
+        if(game->undo) {
+            pushBoardSnapshot(game->undo, game);
+        }
+    }
+
+    updateExtraShapes(game, dt);
+    updateShape(&game->currentShape, game, input, dt);
+    updateBoardWinState(game);
+}
@@ -0,0 +1,400 @@
+/*
+    Runs the Fitris game logic with no window, GL context or audio. Used to check the simulation and to time it.
+
+    usage: headless [frameCount] [levelType] [blockCount] [seed] [boardWidth] [boardHeight]
+           headless record <file> [frameCount] [levelType] [blockCount] [seed] [boardWidth] [boardHeight]
+           headless replay <file> [levelFile] [shapeFile]
+           headless levels <levelFile> [levelsPerKey] [threadCount] [seed]
+           headless batch [gameCount] [framesPerGame] [threadCount] [seed]
+           headless search [queryCount] [levelType] [blockCount] [seed] [threadCount] [maxNodes] [boardWidth] [boardHeight]
+           headless bench
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "gameDefines.h"
+#include "easy_types.h"
+#include "easy.h"
+#include "easy_math.h"
+#include "easy_random.h"
+#include "easy_timer.h"
+#include "easy_array.h"
+#include "easy_lex.h"
+#include "easy_text_io.h"
+
+#include "gameSim.h"
+#include "replay.h"
+#include "boardCamera.h"
+#include "benchmarks.h"
+
+#define HEADLESS_DT (1.0f / 60.0f)
+
+static inline void setButton(GameInput *input, ButtonType button, bool isDown, bool wasDown) {
+    input->buttons[button].isDown = isDown;
+    input->buttons[button].transitionCount = (isDown != wasDown) ? 1 : 0;
+}
+
+//NOTE: A very simple player that picks up a random block of the shape and drags it somewhere random.
+typedef struct {
+    bool mouseDown;
+    int holdFrames;
+    V2 mouseBoardP;
+
+    RandomSeries random; //its own stream so the bot doesn't change the levels the game makes
+} HeadlessBot;
+
+GameInput updateHeadlessBot(HeadlessBot *bot, GameState *game) {
+    GameInput input = {};
+    bool wasDown = bot->mouseDown;
+    if(bot->mouseDown) {
+        if(--bot->holdFrames <= 0) {
+            bot->mouseDown = false;
+        } else {
+            bot->mouseBoardP.x = clamp(0, bot->mouseBoardP.x + (int)randomIndex(&bot->random, 3) - 1, game->boardWidth - 1);
+            bot->mouseBoardP.y = clamp(0, bot->mouseBoardP.y + (int)randomIndex(&bot->random, 3) - 1, game->boardHeight - 1);
+        }
+    } else if(game->currentShape.count > 0 && randomIndex(&bot->random, 8) == 0) {
+        bot->mouseDown = true;
+        bot->holdFrames = 2 + randomIndex(&bot->random, 8);
+        bot->mouseBoardP = game->currentShape.coords[randomIndex(&bot->random, game->currentShape.count)];
+    }
+    setButton(&input, BUTTON_LEFT_MOUSE, bot->mouseDown, wasDown);
+    input.mouseBoardP = bot->mouseBoardP;
+    return input;
+}
+
+//NOTE: Lets the bot play frameCount frames, restarting the level straight away when it fails. recorder can be null.
+void runHeadlessBotGame(GameState *game, HeadlessBot *bot, int frameCount, float dt, ReplayRecorder *recorder) {
+    for(int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+        GameInput input = updateHeadlessBot(bot, game);
+        if(recorder) {
+            recordReplayFrame(recorder, &input, dt);
+        }
+        stepGame(game, &input, dt);
+        if(game->retryLevel) {
+            if(recorder) {
+                recordReplayRestart(recorder, game->currentLevelType, game->currentBlockCount);
+            }
+            restartLevel(game, game->currentLevelType, game->currentBlockCount);
+            bot->mouseDown = false;
+            bot->holdFrames = 0;
+        }
+    }
+}
+
+//NOTE: Plays a recorded game back as fast as it will go and checks it ends up the same as when it was recorded.
+//levelFileName can be null, it has to be the level file the game was recorded with if it had one. shapeFileName is
+//the same for the shape file, without it the built in shapes are used.
+int runReplay(char *fileName, char *levelFileName, char *shapeFileName) {
+    Arena longTermArena = createArena(Megabytes(64));
+    ReplayReader reader = beginReplayReading(&longTermArena, fileName);
+    if(!reader.valid) {
+        printf("couldn't read replay %s\n", fileName);
+        return 1;
+    }
+    ReplayHeader *header = &reader.header;
+
+    GameState game = {};
+    LevelFile levels = {};
+    if(levelFileName) {
+        levels = loadLevelFile(&longTermArena, levelFileName);
+    }
+    if(header->levelFileHash != (levels.valid ? levels.hash : 0)) {
+        printf("replay was recorded with level file %llx, got %llx\n", (unsigned long long)header->levelFileHash,
+               (unsigned long long)(levels.valid ? levels.hash : 0));
+        return 1;
+    }
+    if(levels.valid) {
+        game.levels = &levels;
+    }
+    ShapeCatalogue shapes = defaultShapeCatalogue;
+    if(shapeFileName && !loadShapeCatalogue(shapeFileName, &shapes)) {
+        printf("couldn't read shape file %s\n", shapeFileName);
+        return 1;
+    }
+    if(header->shapeCatalogueHash != shapes.hash) {
+        printf("replay was recorded with shapes %llx, got %llx\n", (unsigned long long)header->shapeCatalogueHash,
+               (unsigned long long)shapes.hash);
+        return 1;
+    }
+    game.shapes = &shapes;
+    initGame(&game, &longTermArena, header->boardWidth, header->boardHeight, (LevelType)header->levelType, header->blockCount, header->random);
+    //NOTE: the game has undo on, so it has to be here too for a recording with undos in it to come out the same
+    UndoRing undoRing = {};
+    initUndoRing(&undoRing, header->boardWidth, header->boardHeight, UNDO_SNAPSHOT_COUNT);
+    game.undo = &undoRing;
+
+    int frameCount = 0;
+    ReplayRecord endRecord = {};
+
+    clock_t startTime = clock();
+    for(;;) {
+        ReplayRecord record = readReplayRecord(&reader);
+        if(record.type == REPLAY_RECORD_FRAME) {
+            stepGame(&game, &reader.input, reader.dt);
+            frameCount++;
+        } else if(record.type == REPLAY_RECORD_RESTART) {
+            restartLevel(&game, record.levelType, record.blockCount);
+        } else {
+            endRecord = record;
+            break;
+        }
+    }
+    double milliseconds = getBenchMilliseconds(startTime);
+
+    printf("frames: %d\n", frameCount);
+    printf("experiencePoints: %d\n", game.experiencePoints);
+    printf("time: %.2fms (%.1f frames per ms)\n", milliseconds, frameCount / max(milliseconds, 0.001f));
+
+    int result = 0;
+    if(endRecord.type != REPLAY_RECORD_END) {
+        printf("replay has no end record, it can't be checked\n");
+        result = 1;
+    } else if(endRecord.frameCount != frameCount || endRecord.hash != getGameHash(&game) ||
+              endRecord.experiencePoints != game.experiencePoints || endRecord.lifePoints != game.lifePoints) {
+        printf("MISMATCH: recorded %d frames, hash %llx, experiencePoints %d, lifePoints %d\n", endRecord.frameCount,
+               (unsigned long long)endRecord.hash, endRecord.experiencePoints, endRecord.lifePoints);
+        printf("             got %d frames, hash %llx, experiencePoints %d, lifePoints %d\n", frameCount,
+               (unsigned long long)getGameHash(&game), game.experiencePoints, game.lifePoints);
+        result = 1;
+    } else {
+        printf("replay matches (hash %llx)\n", (unsigned long long)endRecord.hash);
+    }
+    if(getZobristHash(&game) != computeZobristHash(&game)) {
+        printf("MISMATCH: zobrist hash %llx, worked out from the board %llx\n", (unsigned long long)getZobristHash(&game),
+               (unsigned long long)computeZobristHash(&game));
+        result = 1;
+    }
+    freeUndoRing(&undoRing);
+    return result;
+}
+
+#include "batchSim.h"
+#include "placementSearch.h"
+
+//NOTE: Plays the best placement's path on a copy of the game and checks the shape ends up where the search said.
+bool checkPlacementPath(GameState *game, PlacementSearchResult *result, int placementIndex, Arena *arena) {
+    MemoryArenaMark memMark = takeMemoryMark(arena);
+
+    GameState testGame;
+    cloneGameState(&testGame, game, arena);
+    FitrisShape *shape = &testGame.currentShape;
+
+    int moveCount = 0;
+    PlacementMove *moves = getPlacementPath(result, game, placementIndex, arena, &moveCount);
+    bool valid = true;
+    for(int moveIndex = 0; moveIndex < moveCount && valid; ++moveIndex) {
+        valid = applyPlacementMove(&testGame, shape, &moves[moveIndex]);
+    }
+
+    Placement *placement = &result->placements[placementIndex];
+    valid = valid && !canShapeMove(shape, &testGame, MOVE_DOWN) && shape->count == placement->count &&
+            (game->lifePoints - testGame.lifePoints) == placement->explosivesHit;
+    for(int i = 0; i < placement->count && valid; ++i) {
+        valid = isInShape(shape, placement->coords[i]);
+    }
+
+    releaseMemoryMark(&memMark);
+    return valid;
+}
+
+/*
+    Plays a bot game and runs a placement search on the shape every few frames. Checks the path to the best placement
+    really gets there and reports how many searches a second we manage.
+*/
+void runSearch(int queryCount, LevelType levelType, int blockCount, unsigned int seed, int threadCount, int maxNodes, int boardWidth, int boardHeight) {
+    Arena longTermArena = createArena(Megabytes(64));
+    Arena searchArena = createArena(Megabytes(64));
+
+    GameState game = {};
+    initGame(&game, &longTermArena, boardWidth, boardHeight, levelType, blockCount, initRandomSeries(seed));
+    HeadlessBot bot = {};
+    bot.random = initRandomSeries(seed, 1);
+
+    PlacementSearchSettings settings = getDefaultPlacementSearchSettings();
+    settings.threadCount = threadCount;
+    settings.maxNodes = maxNodes;
+
+    long long totalNodes = 0;
+    long long totalPlacements = 0;
+    long long totalTTHits = 0;
+    int nodeLimitCount = 0;
+    int badPathCount = 0;
+    double searchMilliseconds = 0;
+
+    std::chrono::steady_clock::time_point startTime;
+    for(int queryIndex = 0; queryIndex < queryCount; ) {
+        runHeadlessBotGame(&game, &bot, 7, HEADLESS_DT, 0);
+        if(game.createShape || game.currentShape.count == 0) {
+            continue;
+        }
+
+        MemoryArenaMark memMark = takeMemoryMark(&searchArena);
+        startTime = std::chrono::steady_clock::now();
+        PlacementSearchResult result = searchPlacements(&game, &game.currentShape, settings, &searchArena);
+        searchMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+        totalNodes += result.nodeCount;
+        totalPlacements += result.placementCount;
+        totalTTHits += result.ttHits;
+        nodeLimitCount += result.hitNodeLimit ? 1 : 0;
+        if(result.placementCount > 0 && !checkPlacementPath(&game, &result, 0, &searchArena)) {
+            badPathCount++;
+        }
+        releaseMemoryMark(&memMark);
+        queryIndex++;
+    }
+
+    printf("searches: %d on %d threads, max %d nodes\n", queryCount, threadCount, maxNodes);
+    printf("per search: %.1f nodes, %.1f placements, %.1f transposition hits\n", (double)totalNodes / queryCount,
+           (double)totalPlacements / queryCount, (double)totalTTHits / queryCount);
+    printf("hit the node limit: %d, bad paths: %d\n", nodeLimitCount, badPathCount);
+    printf("time: %.2fms (%.1f searches per second)\n", searchMilliseconds, queryCount / (max(searchMilliseconds, 0.001f) / 1000.0));
+
+    free(searchArena.memory);
+    free(longTermArena.memory);
+}
+
+#include "levelGen.h"
+
+/*
+    Makes the level file, then loads it back and checks every level in it is the one createLevel makes from its seed.
+    Reports how long loading the file and putting a level on the board take.
+*/
+int runLevels(char *fileName, int levelsPerKey, int threadCount, unsigned int seed) {
+    if(!generateLevelFile(fileName, BOARD_WIDTH, BOARD_HEIGHT, levelsPerKey, threadCount, seed)) {
+        printf("couldn't write %s\n", fileName);
+        return 1;
+    }
+
+    Arena longTermArena = createArena(Megabytes(16));
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    LevelFile levels = loadLevelFile(&longTermArena, fileName);
+    double loadMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+    if(!levels.valid) {
+        printf("couldn't read back %s\n", fileName);
+        return 1;
+    }
+
+    GameState game = {};
+    initGame(&game, &longTermArena, BOARD_WIDTH, BOARD_HEIGHT, LEVEL_0, 0, initRandomSeries(seed));
+    GameState generated = {};
+    initGame(&generated, &longTermArena, BOARD_WIDTH, BOARD_HEIGHT, LEVEL_0, 0, initRandomSeries(seed));
+
+    int badLevelCount = 0;
+    double applyMicroseconds = 0;
+    int cellCount = BOARD_WIDTH*BOARD_HEIGHT;
+    for(int entryIndex = 0; entryIndex < levels.header.entryCount; ++entryIndex) {
+        LevelFileEntry *entry = &levels.entries[entryIndex];
+        //NOTE: LEVEL_0 & LEVEL_4 are kept under a block count of 0, createLevel doesn't use it for them
+        int blockCount = entry->blockCount;
+
+        restartLevel(&game, LEVEL_0, 0);
+        startTime = std::chrono::steady_clock::now();
+        applyLevelEntry(&game, &levels, entryIndex);
+        applyMicroseconds += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+
+        generated.random = initRandomSeries((unsigned int)entry->seed);
+        restartLevel(&generated, (LevelType)entry->levelType, blockCount);
+
+        bool same = (game.extraShapeCount == generated.extraShapeCount && game.zobristHash == generated.zobristHash &&
+                     memcmp(game.board.states, generated.board.states, cellCount) == 0 &&
+                     memcmp(game.board.types, generated.board.types, cellCount) == 0);
+        for(int extraIndex = 0; extraIndex < game.extraShapeCount && same; ++extraIndex) {
+            same = (game.extraShapes[extraIndex].type == generated.extraShapes[extraIndex].type &&
+                    game.extraShapes[extraIndex].pos.x == generated.extraShapes[extraIndex].pos.x &&
+                    game.extraShapes[extraIndex].pos.y == generated.extraShapes[extraIndex].pos.y);
+        }
+        if(!same) {
+            badLevelCount++;
+        }
+    }
+
+    printf("loaded %d levels (hash %llx) in %.1fus, %.2fus a level to put on the board, bad levels: %d\n",
+           levels.header.entryCount, (unsigned long long)levels.hash, loadMicroseconds,
+           applyMicroseconds / max(levels.header.entryCount, 1), badLevelCount);
+    free(longTermArena.memory);
+    return (badLevelCount == 0) ? 0 : 1;
+}
+
+int main(int argc, char *args[]) {
+    if(argc > 1 && cmpStrNull(args[1], "bench")) {
+        runBenchmarks();
+        return 0;
+    }
+    if(argc > 1 && cmpStrNull(args[1], "batch")) {
+        int gameCount = (argc > 2) ? atoi(args[2]) : 1000;
+        int framesPerGame = (argc > 3) ? atoi(args[3]) : 20000;
+        int threadCount = (argc > 4) ? atoi(args[4]) : 0;
+        unsigned int seed = (argc > 5) ? (unsigned int)atoi(args[5]) : 0;
+        runBatch(gameCount, framesPerGame, threadCount, seed);
+        return 0;
+    }
+    if(argc > 1 && cmpStrNull(args[1], "search")) {
+        int queryCount = (argc > 2) ? atoi(args[2]) : 1000;
+        LevelType levelType = (argc > 3) ? (LevelType)atoi(args[3]) : START_LEVEL;
+        int blockCount = (argc > 4) ? atoi(args[4]) : 7;
+        unsigned int seed = (argc > 5) ? (unsigned int)atoi(args[5]) : 0;
+        int threadCount = (argc > 6) ? atoi(args[6]) : 1;
+        int maxNodes = (argc > 7) ? atoi(args[7]) : getDefaultPlacementSearchSettings().maxNodes;
+        int boardWidth = (argc > 8) ? atoi(args[8]) : BOARD_WIDTH;
+        int boardHeight = (argc > 9) ? atoi(args[9]) : BOARD_HEIGHT;
+        runSearch(queryCount, levelType, blockCount, seed, threadCount, maxNodes, boardWidth, boardHeight);
+        return 0;
+    }
+    if(argc > 2 && cmpStrNull(args[1], "replay")) {
+        return runReplay(args[2], (argc > 3) ? args[3] : 0, (argc > 4) ? args[4] : 0);
+    }
+    if(argc > 2 && cmpStrNull(args[1], "levels")) {
+        int levelsPerKey = (argc > 3) ? atoi(args[3]) : 16;
+        int threadCount = (argc > 4) ? atoi(args[4]) : 0;
+        unsigned int seed = (argc > 5) ? (unsigned int)atoi(args[5]) : 0;
+        return runLevels(args[2], levelsPerKey, threadCount, seed);
+    }
+    char *recordFileName = 0;
+    if(argc > 2 && cmpStrNull(args[1], "record")) {
+        recordFileName = args[2];
+        args += 2;
+        argc -= 2;
+    }
+
+    int frameCount = (argc > 1) ? atoi(args[1]) : 1000000;
+    LevelType levelType = (argc > 2) ? (LevelType)atoi(args[2]) : START_LEVEL;
+    int blockCount = (argc > 3) ? atoi(args[3]) : 7;
+    unsigned int seed = (argc > 4) ? (unsigned int)atoi(args[4]) : 0;
+    int boardWidth = (argc > 5) ? atoi(args[5]) : BOARD_WIDTH;
+    int boardHeight = (argc > 6) ? atoi(args[6]) : BOARD_HEIGHT;
+
+    Arena longTermArena = createArena(Megabytes(64));
+
+    RandomSeries gameRandom = initRandomSeries(seed);
+    ReplayRecorder recorder = {};
+    if(recordFileName && !beginReplayRecording(&recorder, recordFileName, boardWidth, boardHeight, levelType, blockCount, gameRandom, 0,
+                                                  defaultShapeCatalogue.hash)) {
+        printf("couldn't open %s to record to\n", recordFileName);
+        return 1;
+    }
+
+    GameState game = {};
+    initGame(&game, &longTermArena, boardWidth, boardHeight, levelType, blockCount, gameRandom);
+
+    HeadlessBot bot = {};
+    bot.random = initRandomSeries(seed, 1);
+
+    clock_t startTime = clock();
+    runHeadlessBotGame(&game, &bot, frameCount, HEADLESS_DT, &recorder);
+    double milliseconds = getBenchMilliseconds(startTime);
+    endReplayRecording(&recorder, &game);
+
+    printf("frames: %d\n", frameCount);
+    printf("restarts: %d\n", game.stats.levelsFailed);
+    printf("experiencePoints: %d\n", game.experiencePoints);
+    printf("zobrist hash: %llx (%s)\n", (unsigned long long)getZobristHash(&game),
+           (getZobristHash(&game) == computeZobristHash(&game)) ? "matches the board" : "MISMATCH with the board");
+    printf("time: %.2fms (%.1f frames per ms)\n", milliseconds, frameCount / max(milliseconds, 0.001f));
+
+    return 0;
+}
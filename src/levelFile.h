@@ -0,0 +1,226 @@
+/*
+    Levels made ahead of time by the level generator (levelGen.h, run with: headless levels <file>) and checked to be
+    clearable. When GameState.levels is set createLevel picks one of these instead of throwing random blocks down.
+
+    File layout: a LevelFileHeader, entryCount LevelFileEntry sorted by levelType, blockCount then seed, then the
+    level data. Each level's data is:
+        varint cellCount, then cellCount x (varint board index minus the last one's, u8 BoardState)
+        varint extraShapeCount, then extraShapeCount x (u8 ExtraShapeType, varint x, varint y)
+    Every cell is BOARD_VAL_ALWAYS, the same as createLevel makes them.
+
+    The seed is what the generator seeded the RandomSeries with for createLevel, so a level can always be made again.
+*/
+
+#define LEVEL_FILE_MAGIC 0x564c5446 //'FTLV'
+#define LEVEL_FILE_VERSION 2 //2 has a varint extraShapeCount
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int32_t boardWidth;
+    int32_t boardHeight;
+    int32_t entryCount;
+    uint32_t dataSize;
+} LevelFileHeader;
+
+typedef struct {
+    uint64_t seed;
+    uint8_t levelType;
+    uint8_t blockCount; //see getLevelKeyBlockCount
+    uint16_t cellCount;
+    uint32_t dataOffset; //from the start of the level data
+} LevelFileEntry;
+
+struct LevelFile {
+    bool valid;
+    LevelFileHeader header;
+    LevelFileEntry *entries;
+    uint8_t *data;
+    uint64_t hash; //FNV-1a of the whole file, replays keep it so they know they are using the same levels
+};
+
+//NOTE: LEVEL_0 & LEVEL_4 don't use the block count, so they are all kept under 0.
+static inline int getLevelKeyBlockCount(LevelType levelType, int blockCount) {
+    int result = (levelType == LEVEL_0 || levelType == LEVEL_4) ? 0 : blockCount;
+    return result;
+}
+
+static inline int cmpLevelKey(uint8_t levelTypeA, uint8_t blockCountA, uint8_t levelTypeB, uint8_t blockCountB) {
+    int result = (levelTypeA != levelTypeB) ? (int)levelTypeA - (int)levelTypeB : (int)blockCountA - (int)blockCountB;
+    return result;
+}
+
+///////////////////////************ Writing *************////////////////////
+
+static inline void writeLevelVarint(uint8_t **at, uint64_t value) {
+    while(value >= 0x80) {
+        *(*at)++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *(*at)++ = (uint8_t)value;
+}
+
+static inline size_t getLevelDataMaxSize(int boardWidth, int boardHeight) {
+    //NOTE: an extra shape sits on a cell of its own, so there can't be more of them than cells
+    size_t cellCount = (size_t)boardWidth*boardHeight;
+    size_t result = 10 + cellCount*6 + 10 + cellCount*11;
+    return result;
+}
+
+//NOTE: Writes the level the game has on its board into dest, which needs room for getLevelDataMaxSize bytes.
+//Returns how many bytes it used.
+size_t writeLevelData(GameState *game, uint8_t *dest, int *cellCount) {
+    uint8_t *at = dest;
+    int count = 0;
+    int cellTotal = game->boardWidth*game->boardHeight;
+    for(int boardIndex = 0; boardIndex < cellTotal; ++boardIndex) {
+        count += (game->board.states[boardIndex] != BOARD_NULL);
+    }
+    writeLevelVarint(&at, count);
+    int lastBoardIndex = 0;
+    for(int boardIndex = 0; boardIndex < cellTotal; ++boardIndex) {
+        if(game->board.states[boardIndex] != BOARD_NULL) {
+            assert(game->board.types[boardIndex] == BOARD_VAL_ALWAYS);
+            writeLevelVarint(&at, boardIndex - lastBoardIndex);
+            *at++ = game->board.states[boardIndex];
+            lastBoardIndex = boardIndex;
+        }
+    }
+    writeLevelVarint(&at, game->extraShapeCount);
+    for(int extraIndex = 0; extraIndex < game->extraShapeCount; ++extraIndex) {
+        ExtraShape *extraShape = &game->extraShapes[extraIndex];
+        *at++ = (uint8_t)extraShape->type;
+        writeLevelVarint(&at, (int)extraShape->pos.x);
+        writeLevelVarint(&at, (int)extraShape->pos.y);
+    }
+    *cellCount = count;
+    return (size_t)(at - dest);
+}
+
+//NOTE: entries have to be sorted already. Returns false if the file couldn't be written.
+bool writeLevelFile(char *fileName, int boardWidth, int boardHeight, LevelFileEntry *entries, int entryCount, uint8_t *data, uint32_t dataSize) {
+    bool result = false;
+    FILE *file = fopen(fileName, "wb");
+    if(file) {
+        LevelFileHeader header = {};
+        header.magic = LEVEL_FILE_MAGIC;
+        header.version = LEVEL_FILE_VERSION;
+        header.boardWidth = boardWidth;
+        header.boardHeight = boardHeight;
+        header.entryCount = entryCount;
+        header.dataSize = dataSize;
+        result = (fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  fwrite(entries, sizeof(LevelFileEntry), entryCount, file) == (size_t)entryCount &&
+                  fwrite(data, 1, dataSize, file) == dataSize);
+        fclose(file);
+    }
+    return result;
+}
+
+///////////////////////************ Reading *************////////////////////
+
+//NOTE: Reads the whole file into the arena. Check valid, the board size has to match the game's too.
+LevelFile loadLevelFile(Arena *arena, char *fileName) {
+    LevelFile result = {};
+    FILE *file = fopen(fileName, "rb");
+    if(file) {
+        fseek(file, 0, SEEK_END);
+        long fileSize = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        if(fileSize >= (long)sizeof(LevelFileHeader)) {
+            uint8_t *memory = pushArray(arena, fileSize, uint8_t);
+            if(fread(memory, fileSize, 1, file) == 1) {
+                memcpy(&result.header, memory, sizeof(LevelFileHeader));
+                LevelFileHeader *header = &result.header;
+                size_t expectedSize = sizeof(LevelFileHeader) + sizeof(LevelFileEntry)*(size_t)header->entryCount + header->dataSize;
+                if(header->magic == LEVEL_FILE_MAGIC && header->version == LEVEL_FILE_VERSION && header->entryCount >= 0 &&
+                   expectedSize == (size_t)fileSize) {
+                    result.entries = (LevelFileEntry *)(memory + sizeof(LevelFileHeader));
+                    result.data = (uint8_t *)(result.entries + header->entryCount);
+                    result.valid = true;
+                    //NOTE: every level has at least its cellCount varint
+                    for(int entryIndex = 0; entryIndex < header->entryCount && result.valid; ++entryIndex) {
+                        result.valid = (result.entries[entryIndex].dataOffset < header->dataSize);
+                    }
+
+                    result.hash = 14695981039346656037ULL;
+                    for(long byteIndex = 0; byteIndex < fileSize; ++byteIndex) {
+                        result.hash = (result.hash ^ memory[byteIndex])*1099511628211ULL;
+                    }
+                }
+            }
+        }
+        fclose(file);
+    }
+    return result;
+}
+
+//NOTE: The entries for a level type & block count. Returns how many there are, *firstEntry is the first of them.
+int findLevelEntries(LevelFile *levels, LevelType levelType, int blockCount, int *firstEntry) {
+    uint8_t keyType = (uint8_t)levelType;
+    uint8_t keyBlockCount = (uint8_t)getLevelKeyBlockCount(levelType, blockCount);
+
+    //NOTE: binary search for the first entry not before the key
+    int low = 0;
+    int high = levels->header.entryCount;
+    while(low < high) {
+        int middle = (low + high) / 2;
+        LevelFileEntry *entry = &levels->entries[middle];
+        if(cmpLevelKey(entry->levelType, entry->blockCount, keyType, keyBlockCount) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    int count = 0;
+    while(low + count < levels->header.entryCount &&
+          cmpLevelKey(levels->entries[low + count].levelType, levels->entries[low + count].blockCount, keyType, keyBlockCount) == 0) {
+        count++;
+    }
+    *firstEntry = low;
+    return count;
+}
+
+static inline uint64_t readLevelVarint(uint8_t **at, uint8_t *end) {
+    uint64_t result = 0;
+    int shift = 0;
+    while(*at < end && shift < 64) {
+        uint8_t byte = *(*at)++;
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        shift += 7;
+        if(!(byte & 0x80)) {
+            break;
+        }
+    }
+    return result;
+}
+
+//NOTE: Puts a level from the file onto the board. The board has to be empty, like createLevel.
+void applyLevelEntry(GameState *game, LevelFile *levels, int entryIndex) {
+    assert(entryIndex >= 0 && entryIndex < levels->header.entryCount);
+    assert(levels->header.boardWidth == game->boardWidth && levels->header.boardHeight == game->boardHeight);
+    LevelFileEntry *entry = &levels->entries[entryIndex];
+    uint8_t *at = levels->data + entry->dataOffset;
+    uint8_t *end = levels->data + levels->header.dataSize;
+
+    int cellCount = (int)readLevelVarint(&at, end);
+    assert(cellCount == entry->cellCount);
+    int boardIndex = 0;
+    for(int cellIndex = 0; cellIndex < cellCount && at < end; ++cellIndex) {
+        boardIndex += (int)readLevelVarint(&at, end);
+        if(at == end) {
+            break; //NOTE: the level was cut short, there's no state byte
+        }
+        BoardState state = (BoardState)*at++;
+        assert(boardIndex < game->boardWidth*game->boardHeight && state > BOARD_NULL && state < BOARD_INVALID);
+        setBoardState(game, v2(boardIndex % game->boardWidth, boardIndex / game->boardWidth), state, BOARD_VAL_ALWAYS);
+    }
+    int extraShapeCount = (int)readLevelVarint(&at, end);
+    for(int extraIndex = 0; extraIndex < extraShapeCount && at < end; ++extraIndex) {
+        //NOTE: at < end above covers the type byte
+        ExtraShapeType type = (ExtraShapeType)*at++;
+        int x = (int)readLevelVarint(&at, end);
+        int y = (int)readLevelVarint(&at, end);
+        addExtraShape(game, type, v2(x, y));
+    }
+}
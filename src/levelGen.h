@@ -0,0 +1,212 @@
+/*
+    Makes the level file (levelFile.h) offline. For every LevelType & block count it tries seeds in order, makes the
+    level createLevel would make from that seed and keeps it if a bot playing the best placement from the placement
+    search can clear LEVEL_CHECK_LINES lines within LEVEL_CHECK_SHAPES shapes without the level failing.
+
+    Each key is one job. Workers take the next job from an atomic counter and find its first levelsPerKey solvable
+    seeds, so the file comes out the same however many threads made it. The main thread then joins the jobs' data
+    up in key order and writes the file.
+*/
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#define LEVEL_CHECK_SHAPES 24
+#define LEVEL_CHECK_LINES 2
+#define LEVEL_CHECK_NODES 4096
+#define LEVEL_GEN_MIN_BLOCKS 4
+#define LEVEL_GEN_MAX_BLOCKS 11 //the same spread as batchSim
+#define LEVEL_GEN_MAX_SEEDS 1000 //seeds tried a key before we give up on it
+#define LEVEL_GEN_JOB_COUNT (2 + 3*(LEVEL_GEN_MAX_BLOCKS - LEVEL_GEN_MIN_BLOCKS + 1))
+
+typedef struct {
+    LevelType levelType;
+    int blockCount;
+
+    int levelCount;
+    LevelFileEntry *entries; //dataOffset is into this job's data until the file is put together
+    uint8_t *data;
+    uint32_t dataSize;
+
+    int seedsTried;
+} LevelGenJob;
+
+typedef struct {
+    int boardWidth;
+    int boardHeight;
+    int levelsPerKey;
+    uint64_t seed;
+
+    std::atomic<int> nextJob;
+    LevelGenJob jobs[LEVEL_GEN_JOB_COUNT];
+} LevelGenerator;
+
+/*
+    Plays the level with the best placement each time. The shape is put down as soon as it gets there, the windmills
+    get a second a shape. Doesn't need the game to have been stepped yet.
+*/
+bool checkLevelSolvable(GameState *game, Arena *arena) {
+    PlacementSearchSettings settings = getDefaultPlacementSearchSettings();
+    settings.maxNodes = LEVEL_CHECK_NODES;
+    settings.threadCount = 1;
+
+    GameInput input = {};
+    bool result = false;
+    for(int shapeIndex = 0; shapeIndex < LEVEL_CHECK_SHAPES && !result; ++shapeIndex) {
+        //NOTE: spawns the shape, a dt of 0 so it doesn't move
+        stepGame(game, &input, 0);
+        if(game->retryLevel) {
+            break;
+        }
+
+        MemoryArenaMark memMark = takeMemoryMark(arena);
+        FitrisShape *shape = &game->currentShape;
+        PlacementSearchResult search = searchPlacements(game, shape, settings, arena);
+        bool placed = (search.placementCount > 0 && !search.placements[0].blocksSpawn);
+        if(placed) {
+            int moveCount = 0;
+            PlacementMove *moves = getPlacementPath(&search, game, 0, arena, &moveCount);
+            for(int moveIndex = 0; moveIndex < moveCount && placed; ++moveIndex) {
+                placed = applyPlacementMove(game, shape, &moves[moveIndex]);
+            }
+        }
+        releaseMemoryMark(&memMark);
+        if(!placed) {
+            break;
+        }
+
+        solidfyShape(shape, game);
+        game->createShape = true;
+        game->wasHitByExplosive = false;
+        resetMouseUI(game);
+        updateBoardWinState(game);
+        updateExtraShapes(game, 1.0f);
+
+        result = (game->stats.linesCleared >= LEVEL_CHECK_LINES && game->lifePoints > 0);
+    }
+    return result;
+}
+
+void runLevelGenJob(LevelGenerator *generator, LevelGenJob *job, Arena *arena) {
+    //NOTE: LEVEL_0 & LEVEL_4 come out the same whatever the seed, one of them is enough
+    int levelsWanted = (getLevelKeyBlockCount(job->levelType, job->blockCount) == 0) ? 1 : generator->levelsPerKey;
+
+    size_t levelMaxSize = getLevelDataMaxSize(generator->boardWidth, generator->boardHeight);
+    job->entries = (LevelFileEntry *)calloc(levelsWanted, sizeof(LevelFileEntry));
+    job->data = (uint8_t *)malloc(levelMaxSize*levelsWanted);
+
+    for(int seedIndex = 0; seedIndex < LEVEL_GEN_MAX_SEEDS && job->levelCount < levelsWanted; ++seedIndex) {
+        MemoryArenaMark memMark = takeMemoryMark(arena);
+        uint64_t seed = generator->seed + seedIndex;
+        GameState game = {};
+        initGame(&game, arena, generator->boardWidth, generator->boardHeight, job->levelType, job->blockCount, initRandomSeries((unsigned int)seed));
+
+        int cellCount = 0;
+        size_t dataSize = writeLevelData(&game, job->data + job->dataSize, &cellCount);
+        if(checkLevelSolvable(&game, arena)) {
+            LevelFileEntry *entry = &job->entries[job->levelCount++];
+            entry->seed = seed;
+            entry->levelType = (uint8_t)job->levelType;
+            entry->blockCount = (uint8_t)getLevelKeyBlockCount(job->levelType, job->blockCount);
+            entry->cellCount = (uint16_t)cellCount;
+            entry->dataOffset = job->dataSize;
+            job->dataSize += (uint32_t)dataSize;
+        }
+        job->seedsTried++;
+        releaseMemoryMark(&memMark);
+    }
+}
+
+void runLevelGenWorker(LevelGenerator *generator) {
+    Arena arena = createArena(Megabytes(16));
+    for(;;) {
+        int jobIndex = generator->nextJob++;
+        if(jobIndex >= LEVEL_GEN_JOB_COUNT) {
+            break;
+        }
+        runLevelGenJob(generator, &generator->jobs[jobIndex], &arena);
+    }
+    free(arena.memory);
+}
+
+//NOTE: threadCount of 0 uses every core. Returns false if the file couldn't be written.
+bool generateLevelFile(char *fileName, int boardWidth, int boardHeight, int levelsPerKey, int threadCount, uint64_t seed) {
+    if(threadCount <= 0) {
+        threadCount = (int)std::thread::hardware_concurrency();
+    }
+    threadCount = (int)clamp(1, threadCount, MAX_BATCH_THREADS);
+
+    LevelGenerator *generator = new LevelGenerator();
+    generator->boardWidth = boardWidth;
+    generator->boardHeight = boardHeight;
+    generator->levelsPerKey = levelsPerKey;
+    generator->seed = seed;
+
+    //NOTE: in the file's order, see cmpLevelKey
+    int jobCount = 0;
+    for(int levelIndex = LEVEL_0; levelIndex <= LEVEL_4; ++levelIndex) {
+        LevelType levelType = (LevelType)levelIndex;
+        for(int blockCount = LEVEL_GEN_MIN_BLOCKS; blockCount <= LEVEL_GEN_MAX_BLOCKS; ++blockCount) {
+            LevelGenJob *job = &generator->jobs[jobCount++];
+            job->levelType = levelType;
+            job->blockCount = blockCount;
+            if(getLevelKeyBlockCount(levelType, blockCount) == 0) {
+                break;
+            }
+        }
+    }
+    assert(jobCount == LEVEL_GEN_JOB_COUNT);
+
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    //NOTE: this thread is a worker too
+    std::thread threads[MAX_BATCH_THREADS];
+    for(int threadIndex = 1; threadIndex < threadCount; ++threadIndex) {
+        threads[threadIndex] = std::thread(runLevelGenWorker, generator);
+    }
+    runLevelGenWorker(generator);
+    for(int threadIndex = 1; threadIndex < threadCount; ++threadIndex) {
+        threads[threadIndex].join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    int entryCount = 0;
+    uint32_t dataSize = 0;
+    int seedsTried = 0;
+    printf("level  blocks  levels  solvable\n");
+    for(int jobIndex = 0; jobIndex < LEVEL_GEN_JOB_COUNT; ++jobIndex) {
+        LevelGenJob *job = &generator->jobs[jobIndex];
+        entryCount += job->levelCount;
+        dataSize += job->dataSize;
+        seedsTried += job->seedsTried;
+        printf("%5d  %6d  %6d  %7.1f%%\n", job->levelType, job->blockCount, job->levelCount,
+               100.0*job->levelCount / (job->seedsTried ? job->seedsTried : 1));
+    }
+
+    LevelFileEntry *entries = (LevelFileEntry *)calloc(entryCount + 1, sizeof(LevelFileEntry));
+    uint8_t *data = (uint8_t *)malloc(dataSize + 1);
+    int entryAt = 0;
+    uint32_t dataAt = 0;
+    for(int jobIndex = 0; jobIndex < LEVEL_GEN_JOB_COUNT; ++jobIndex) {
+        LevelGenJob *job = &generator->jobs[jobIndex];
+        for(int levelIndex = 0; levelIndex < job->levelCount; ++levelIndex) {
+            LevelFileEntry *entry = &entries[entryAt++];
+            *entry = job->entries[levelIndex];
+            entry->dataOffset += dataAt;
+        }
+        memcpy(data + dataAt, job->data, job->dataSize);
+        dataAt += job->dataSize;
+        free(job->entries);
+        free(job->data);
+    }
+
+    bool result = writeLevelFile(fileName, boardWidth, boardHeight, entries, entryCount, data, dataSize);
+    printf("%d levels from %d seeds on %d threads: %.2fs, %u bytes of level data\n", entryCount, seedsTried, threadCount,
+           seconds, dataSize);
+
+    free(data);
+    free(entries);
+    delete generator;
+    return result;
+}
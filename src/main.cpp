@@ -20,6 +20,9 @@
 
 #include "easy_transition.h"
 #include "menu.h"
+#include "gameSim.h"
+#include "replay.h"
+#include "boardCamera.h"
 
 int EventFilter(void* userdata, SDL_Event* event)
 {
@@ -41,75 +44,29 @@ int EventFilter(void* userdata, SDL_Event* event)
     return 1;
 }
 
-typedef enum {
-    BOARD_NULL,
-    BOARD_STATIC,
-    BOARD_SHAPE,
-    BOARD_EXPLOSIVE,
-    BOARD_INVALID, //For out of bounds 
-} BoardState;
-
-#define MAX_SHAPE_COUNT 16
-typedef struct {
-    V2 coords[MAX_SHAPE_COUNT];
-    int count;
-    bool valid;
-
-    Timer moveTimer;
-} FitrisShape;
-
-typedef enum {
-    SHAPE_WINDMILL,
-} ExtraShapeType;
-
+/*
+    The background of the board and the settled cells on it, drawn into their own frame buffer. It is only drawn
+    again where the board's layerRows say it changed, or all of it when the camera moves. The frame draws it as one
+    quad and puts the shape, the fading cells & the drag targets on top.
+*/
 typedef struct {
-    ExtraShapeType type;
-    V2 pos;
-
-    Timer timer;
-
-    bool onX; //on x or on y
-    bool isOut; //going out or in
-
-    int count;
-
-    int xMax;
-    int yMax;
-    
-} ExtraShape;
-
-typedef enum {
-    BOARD_VAL_NULL,
-    BOARD_VAL_OLD,
-    BOARD_VAL_ALWAYS,
-    BOARD_VAL_TRANSIENT, //this isn't used for anything, just to make it so we aren't using the other ones. 
-} BoardValType;
-
-typedef struct {
-    BoardValType type;
-    BoardState state;
-    BoardState prevState;
-
-    V4 color;
-
-    Timer fadeTimer;
-} BoardValue;
-
-typedef enum {
-    LEVEL_0,
-    LEVEL_1, 
-    LEVEL_2, 
-    LEVEL_3, 
-    LEVEL_4, 
-} LevelType;
+    FrameBuffer frameBuffer;
+    Texture texture; //the frame buffer's colour texture, to draw it with
+    bool valid; //false until the first time it is drawn
+    V2 cameraPos; //the camera it was drawn with
+    float zoom;
+    int redrawnRowCount; //rows drawn again last frame
+} BoardLayer;
 
 typedef struct {
     Arena *soundArena;
-    int boardWidth;
-    int boardHeight;
-    BoardValue *board;
 
-    FitrisShape currentShape;
+    GameState game;
+    ReplayRecorder replay; //every game is recorded to REPLAY_FILE_NAME, play it back with: headless replay <file>
+    UndoRing undoRing;
+    LevelFile levels;
+    ShapeCatalogue shapes;
+
     Texture *stoneTex;
     Texture *woodTex;
     Texture *bgTex;
@@ -127,36 +84,17 @@ typedef struct {
 
     TransitionState transitionState;
 
-    int lifePoints;
-    int lifePointsMax;
-    bool wasHitByExplosive; 
-
-    int extraShapeCount;
-    ExtraShape extraShapes[32];
-
-    bool createShape;
-
-    int currentBlockCount;
-    LevelType currentLevelType;
-
-    Timer moveTimer;
-
-    int currentHotIndex;
-
     MenuInfo menuInfo;
-    
-    int experiencePoints;
 
     particle_system particleSystem;
 
-    float slowTimeFactor;
-
     ////////TODO: This stuff below should be in another struct so isn't there for all projects. 
     Arena *longTermArena;
     float dt;
     SDL_Window *windowHandle;
     AppKeyStates *keyStates;
     FrameBuffer mainFrameBuffer;
+    BoardLayer boardLayer;
     Matrix4 metresToPixels;
     Matrix4 pixelsToMeters;
     V2 screenRelativeSize;
@@ -168,509 +106,27 @@ typedef struct {
     GLuint renderbufferId;
 
     Font *font;
+    bool showRenderStats; //F1 toggles the last frame's RenderStats in the corner
 
     V3 cameraPos;
+    BoardCamera camera; //cameraPos follows it
+    Matrix4 boardToPixels; //metresToPixels with the camera's zoom
+    Matrix4 boardToScreen; //board positions all the way to the screen, the camera & boardToPixels & the projection
 
     unsigned int lastTime;
     ///////
     
 } FrameParams;
 
-typedef enum {
-    MOVE_LEFT, 
-    MOVE_RIGHT,
-    MOVE_DOWN
-} MoveType;
-
-
-
-static inline float getRandNum01_include() {
-    float result = ((float)rand() / (float)RAND_MAX);
-    return result;
-}
-
-static inline float getRandNum01() {
-    float result = ((float)rand() / (float)(RAND_MAX - 1));
-    return result;
-}
-
-
-BoardState getBoardState(FrameParams *params, V2 pos) {
-    BoardState result = BOARD_INVALID;
-    if(pos.x >= 0 && pos.x < params->boardWidth && pos.y >= 0 && pos.y < params->boardHeight) {
-        BoardValue *val = &params->board[params->boardWidth*(int)pos.y + (int)pos.x];
-        result = val->state;
-        assert(result != BOARD_INVALID);
-    }
-    
-    return result;
-}
-
-BoardValue *getBoardValue(FrameParams *params, V2 pos) {
-    BoardValue *result = 0;
-    if(pos.x >= 0 && pos.x < params->boardWidth && pos.y >= 0 && pos.y < params->boardHeight) {
-        BoardValue *val = &params->board[params->boardWidth*(int)pos.y + (int)pos.x];
-        result = val;
-    }
-    
-    return result;
-}
-
-bool inBoardBounds(FrameParams *params, V2 pos) {
-    bool result = false;
-    if(pos.x >= 0 && pos.x < params->boardWidth && pos.y >= 0 && pos.y < params->boardHeight) {
-        result = true;
-    }
-    return result;
-}
-
-void setBoardState(FrameParams *params, V2 pos, BoardState state, BoardValType type) {
-    if(pos.x >= 0 && pos.x < params->boardWidth && pos.y >= 0 && pos.y < params->boardHeight) {
-        BoardValue *val = &params->board[params->boardWidth*(int)pos.y + (int)pos.x];
-        val->prevState = val->state;
-        val->state = state;
-        val->type = type;
-        val->fadeTimer = initTimer(FADE_TIMER_INTERVAL);
-    } else {
-        assert(!"invalid code path");
-    }
-}
-
-void createLevel(FrameParams *params, int blockCount, LevelType levelType) {
-    if(levelType == LEVEL_4) {
-        assert(params->extraShapeCount < arrayCount(params->extraShapes));
-        ExtraShape *shape = params->extraShapes + params->extraShapeCount++;
-        shape->type = SHAPE_WINDMILL;
-
-        shape->pos = v2(2, 2);
-
-        setBoardState(params, shape->pos, BOARD_STATIC, BOARD_VAL_ALWAYS);    
-        shape->timer = initTimer(0.5f);
-        shape->isOut = true;
-        shape->xMax = 3;
-        shape->yMax = 3;
-
-    }
-
-    for(int i = 0; i < blockCount && levelType != LEVEL_0 && levelType != LEVEL_4; ++i) {
-        V2 pos = {};
-        float rand1 = getRandNum01_include();
-        float rand2 = getRandNum01_include();
-        pos.x = lerp(0, rand1, (float)(params->boardWidth - 1));
-        pos.y = lerp(0, rand2, (float)(params->boardHeight - 5)); // so we don't block the shape creation
-
-        BoardState state = BOARD_NULL;
-        switch(levelType) {
-            case LEVEL_1: {
-                state = BOARD_STATIC;
-            } break;
-            case LEVEL_2: {
-                int type = (int)lerp(0, getRandNum01(), 2);
-                if(type == 0) { state = BOARD_STATIC; }
-                if(type == 1) { state = BOARD_EXPLOSIVE; }
-            } break;
-            case LEVEL_3: {
-                state = BOARD_EXPLOSIVE;
-            } break;
-            default: {
-                assert(!"case not handled");
-            }
-        }
-        
-        setBoardState(params, v2((int)pos.x, (int)pos.y), state, BOARD_VAL_ALWAYS);    
-    }
-}
-
-V2 getMoveVec(MoveType moveType) {
-    V2 moveVec = v2(0, 0);
-    if(moveType == MOVE_LEFT) {
-        moveVec = v2(-1, 0);
-    } else  if(moveType == MOVE_RIGHT) {
-        moveVec = v2(1, 0);
-    } else  if(moveType == MOVE_DOWN) {
-        moveVec = v2(0, -1);
-    } else {
-        assert(!"not valid path");
-    }
-    return moveVec;
-}
-
-bool canShapeMove(FitrisShape *shape, FrameParams *params, MoveType moveType) {
-    bool result = false;
-    bool valid = true;
-    int leftMostPos = params->boardWidth;
-    int rightMostPos = 0;
-    int bottomMostPos = params->boardHeight;;
-    V2 moveVec = getMoveVec(moveType);
-    for(int i = 0; i < shape->count; ++i) {
-        V2 pos = shape->coords[i];
-        BoardState state = getBoardState(params, v2_plus(pos, moveVec));
-        if(!(state == BOARD_NULL || state == BOARD_SHAPE || state == BOARD_EXPLOSIVE)) {
-            valid = false;
-            break;
-        }
-        if(shape->coords[i].x < leftMostPos) {
-            leftMostPos = shape->coords[i].x;
-        }
-        if(shape->coords[i].x > rightMostPos) {
-            rightMostPos = shape->coords[i].x;
-        }
-        if(shape->coords[i].y < bottomMostPos) {
-            bottomMostPos = shape->coords[i].y;
-        }
-    }
-
-    //Check shape won't move off the board//
-    if(moveType == MOVE_LEFT) {
-        if(leftMostPos > 0 && valid) {
-            result = true;
-        }
-    } else if(moveType == MOVE_RIGHT) {
-        assert(rightMostPos < params->boardWidth);
-        if(rightMostPos < (params->boardWidth - 1) && valid) {
-            result = true;
-        } 
-    } else if(moveType == MOVE_DOWN) { 
-        if(bottomMostPos > 0 && valid) {
-            assert(bottomMostPos < params->boardHeight);
-            result = true;
-        }
-    }
-    return result;
-}
-bool isInShape(FitrisShape *shape, V2 pos) {
-    bool result = false;
-    for(int i = 0; i < shape->count; ++i) {
-      V2 shapePos = shape->coords[i];
-      if(pos.x == shapePos.x && pos.y == shapePos.y) {
-        result = true;
-        break;
-      }
-   }
-   return result;
-}
-
-typedef struct {
-    bool result;
-    int index;
-} QueryShapeInfo;
-
-QueryShapeInfo isRepeatedInShape(FitrisShape *shape, V2 pos, int index) {
-    QueryShapeInfo result = {};
-    for(int i = 0; i < shape->count; ++i) {
-      V2 shapePos = shape->coords[i];
-      if(i != index && pos.x == shapePos.x && pos.y == shapePos.y) {
-        result.result = true;
-        result.index = i;
-        assert(i != index);
-        break;
-      }
-   }
-   return result;
-}
-
-bool moveShape(FitrisShape *shape, FrameParams *params, MoveType moveType) {
-    bool result = canShapeMove(shape, params, moveType);
-    if(result) {
-        V2 moveVec = getMoveVec(moveType);
-
-        assert(!params->wasHitByExplosive);
-       // CHECK FOR EXPLOSIVES HIT
-        int indexesHitCount = 0;
-        int indexesHit[MAX_SHAPE_COUNT] = {};
-        for(int i = 0; i < shape->count; ++i) {
-          V2 oldPos = shape->coords[i];
-          V2 newPos = v2_plus(oldPos, moveVec);
-          BoardState state = getBoardState(params, newPos);
-          if(state == BOARD_EXPLOSIVE) {
-            params->lifePoints--;
-            params->wasHitByExplosive = true;
-            playSound(params->soundArena, params->explosiveSound, 0, AUDIO_FOREGROUND);
-            //remove from shapea
-            assert(indexesHitCount < arrayCount(indexesHit));
-            indexesHit[indexesHitCount++] = i;
-            setBoardState(params, oldPos, BOARD_NULL, BOARD_VAL_TRANSIENT);    
-            setBoardState(params, newPos, BOARD_NULL, BOARD_VAL_TRANSIENT);    
-          }
-        }
-
-        for(int hitIndex = 0; hitIndex < indexesHitCount; ++hitIndex) {
-            int indexAt = indexesHit[hitIndex];
-            shape->coords[indexAt] = shape->coords[--shape->count];
-        }
-
-       for(int i = 0; i < shape->count; ++i) {
-            V2 oldPos = shape->coords[i];
-            V2 newPos = v2_plus(oldPos, moveVec);
-           
-            assert(getBoardState(params, oldPos) == BOARD_SHAPE);
-            BoardState newPosState = getBoardState(params, newPos);
-            assert(newPosState == BOARD_SHAPE || newPosState == BOARD_NULL);
-
-            QueryShapeInfo info = isRepeatedInShape(shape, oldPos, i);
-            if(!info.result) { //dind't just get set by the block in shape before. 
-                setBoardState(params, oldPos, BOARD_NULL, BOARD_VAL_TRANSIENT);    
-            }
-            setBoardState(params, newPos, BOARD_SHAPE, BOARD_VAL_TRANSIENT);    
-            shape->coords[i] = newPos;
-        }
-        playSound(params->soundArena, params->moveSound, 0, AUDIO_FOREGROUND);
-    }
-    return result;
-}
-
-void solidfyShape(FitrisShape *shape, FrameParams *params) {
-    for(int i = 0; i < shape->count; ++i) {
-        V2 pos = shape->coords[i];
-        BoardValue *val = getBoardValue(params, pos);
-        if(val->state == BOARD_SHAPE) {
-            setBoardState(params, pos, BOARD_STATIC, BOARD_VAL_OLD);
-        }
-        val->color = COLOR_WHITE;
-
-    }
-    playSound(params->soundArena, params->solidfyShapeSound, 0, AUDIO_FOREGROUND);
-}
-
-/* we were using the below code to do a flood fill to see if the shape was connected. But realised I could just see if the new 
-position had any neibours of BORAD_SHAPE. 
-*/
-typedef struct VisitedQueue VisitedQueue;
-typedef struct VisitedQueue {
-    V2 pos;
-    VisitedQueue *next;
-    VisitedQueue *prev;
-} VisitedQueue;
-
-void addToQueryList(FrameParams *params, VisitedQueue *sentinel, V2 pos, Arena *arena, bool *boardArray, int boardWidth) {
-    bool *visitedPtr = &boardArray[(((int)pos.y)*boardWidth) + (int)pos.x];
-    bool visited = *visitedPtr;
-    
-    if(!visited && getBoardState(params, pos) == BOARD_SHAPE) {
-        *visitedPtr = true;
-        VisitedQueue *queue = pushStruct(arena, VisitedQueue); 
-        queue->pos = pos;
-
-        //add to the search queue
-        assert(sentinel->prev->next == sentinel);
-        queue->prev = sentinel->prev;
-        queue->next = sentinel;
-        sentinel->prev->next = queue;
-        sentinel->prev = queue;
-    }
-} 
-/* end the queue stuff for the flood fill.*/
-
-typedef struct {
-    int count;
-    V2 poses[MAX_SHAPE_COUNT];
-} IslandInfo;
-
-IslandInfo getShapeIslandCount(FitrisShape *shape, V2 startPos, FrameParams *params) {
-    IslandInfo info = {};
-    //NOTE: This is since shape can be blown apart we want to still be able to move a block on their 
-    //own island. So the count isn't the shapeCount but only a portion in this count. So we first search 
-    //how big the island is and match against that. 
-
-    MemoryArenaMark memMark = takeMemoryMark(params->longTermArena);
-    bool *boardArray = pushArray(params->longTermArena, params->boardWidth*params->boardHeight, bool);
-
-    VisitedQueue sentinel = {};
-    sentinel.next = sentinel.prev = &sentinel;
-
-#define ADD_TO_QUERY_LIST(toMoveVec, thePos) addToQueryList(params, &sentinel, v2_plus(thePos, toMoveVec), params->longTermArena, boardArray, params->boardWidth);
-    ADD_TO_QUERY_LIST(v2(0, 0), startPos);
-
-    VisitedQueue *queryAt = sentinel.next;
-    assert(queryAt != &sentinel);
-    while(queryAt != &sentinel) {
-        V2 pos = queryAt->pos;
-
-        assert(info.count < arrayCount(info.poses));
-        info.poses[info.count++] = pos;
-
-        ADD_TO_QUERY_LIST(v2(1, 0), pos);
-        ADD_TO_QUERY_LIST(v2(-1, 0), pos);
-        ADD_TO_QUERY_LIST(v2(0, 1), pos);
-        ADD_TO_QUERY_LIST(v2(0, -1), pos);
-#if CAN_ALTER_SHAPE_DIAGONAL 
-        ADD_TO_QUERY_LIST(v2(1, 1), pos);
-        ADD_TO_QUERY_LIST(v2(-1, 1), pos);
-        ADD_TO_QUERY_LIST(v2(-1, -1), pos);
-        ADD_TO_QUERY_LIST(v2(1, -1), pos);
-#endif
-        queryAt = queryAt->next;
-    }
-    releaseMemoryMark(&memMark);
-    assert(info.count <= shape->count);
-
-    return info;
-}
-
-bool shapeStillConnected(FitrisShape *shape, int currentHotIndex, V2 boardPosAt, FrameParams *params) {
-    bool result = true;
-
-    for(int i = 0; i < shape->count; ++i) {
-        V2 pos = shape->coords[i];
-        if(boardPosAt.x == pos.x && boardPosAt.y == pos.y) {
-            result = false;
-            break;
-        }
-
-        BoardState state = getBoardState(params, boardPosAt);
-        if(state != BOARD_NULL) {
-            result = false;
-            break;
-        }
-    }
-    if(result) {
-        V2 oldPos = shape->coords[currentHotIndex];
-
-        BoardValue *oldVal = getBoardValue(params, oldPos);
-        assert(oldVal->state == BOARD_SHAPE);
-
-        IslandInfo mainIslandInfo = getShapeIslandCount(shape, oldPos, params);
-        assert(mainIslandInfo.count >= 1);
-        if(mainIslandInfo.count <= 1) {
-            result = false;
-        } else {
-            V2 idPos = mainIslandInfo.poses[1]; //won't be that starting pos. 
-            //temporaialy set the board state to where the shape was to be null, so this can act as a bridge in the flood fill
-            oldVal->state = BOARD_NULL;
-
-            BoardValue *newVal = getBoardValue(params, boardPosAt);
-            assert(newVal->state == BOARD_NULL);
-            newVal->state = BOARD_SHAPE;
-            ////   
-
-            IslandInfo islandInfo = getShapeIslandCount(shape, boardPosAt, params);
-
-            bool found = false;
-            for(int index = 0; index < islandInfo.count; ++index) {
-                V2 srchPos = islandInfo.poses[index];
-                if(srchPos.x == idPos.x && srchPos.y == idPos.y) {
-                    found = true;
-                    break;
-                }
-            }
-
-            if(islandInfo.count != mainIslandInfo.count || !found) {
-                result = false;
-            }
-            //set the state back to being a shape. 
-            oldVal->state = BOARD_SHAPE;
-            newVal->state = BOARD_NULL;
-        }
-    }
-    
-    return result;
-}
-
-void resetMouseUI(FrameParams *params) {
-    params->currentHotIndex = -1; //reset hot ui   
-    params->slowTimeFactor = 1; 
-}
-
-void updateAndRenderShape(FitrisShape *shape, V3 cameraPos, V2 resolution, V2 screenDim, Matrix4 metresToPixels, FrameParams *params) {
-    assert(!params->wasHitByExplosive);
-    assert(!params->createShape);
-    bool areRearranging = (params->currentHotIndex >= 0);
-#if CAN_MOVE_WITH_ARROW_KEYS
-    if(wasPressed(gameButtons, BUTTON_LEFT) && !areRearranging) {
-        moveShape(shape, params, MOVE_LEFT);
-    }
-    if(wasPressed(gameButtons, BUTTON_RIGHT) && !areRearranging) {
-        moveShape(shape, params, MOVE_RIGHT);
-    }
-    if(wasPressed(gameButtons, BUTTON_DOWN) && !areRearranging) {
-        if(moveShape(shape, params, MOVE_DOWN)) {
-            params->moveTimer.value = 0;
-        }
-    }
-#endif
-
-    if(wasReleased(gameButtons, BUTTON_LEFT_MOUSE)) {
-        resetMouseUI(params);
-    }
-
-    bool turnSolid = false;
-    TimerReturnInfo timerInfo = updateTimer(&params->moveTimer, params->slowTimeFactor*params->dt);
-    if(timerInfo.finished) {
-        turnTimerOn(&params->moveTimer);
-        if(!moveShape(shape, params, MOVE_DOWN)) {
-            turnSolid = true;
-        }
-    }
-    params->wasHitByExplosive = false;
-    if(turnSolid) {// || params->wasHitByExplosive
-        solidfyShape(shape, params);
-        params->createShape = true; 
-        params->wasHitByExplosive = false;   
-        resetMouseUI(params);
-    } else {
-        
-        int hotBlockIndex = -1;
-        for(int i = 0; i < shape->count; ++i) {
-            V2 *pos = shape->coords +i;
-            
-            RenderInfo renderInfo = calculateRenderInfo(v3(pos->x, pos->y, -1), v3(1, 1, 1), cameraPos, metresToPixels);
-
-            Rect2f blockBounds = rect2fCenterDimV2(renderInfo.transformPos.xy, renderInfo.transformDim.xy);
-            
-            V4 color = COLOR_WHITE;
-            
-            if(inBounds(params->keyStates->mouseP_yUp, blockBounds, BOUNDS_RECT)) {
-                hotBlockIndex = i;
-                if(params->currentHotIndex < 0) {
-                    color = COLOR_YELLOW;
-                }
-            }
-            if(params->currentHotIndex == i) {
-                assert(isDown(gameButtons, BUTTON_LEFT_MOUSE));
-                color = COLOR_GREEN;
-            }
-            BoardValue *val = getBoardValue(params, *pos);
-            assert(val);
-            val->color = color;
-        }
-
-        if(wasPressed(gameButtons, BUTTON_LEFT_MOUSE) && hotBlockIndex >= 0) {
-            params->currentHotIndex = hotBlockIndex;
-            params->slowTimeFactor = 0.0f;  //don't move block if we are rearranging
-        }
-        
-        if(params->currentHotIndex >= 0) {
-            //We are holding onto a block
-            V2 pos = params->keyStates->mouseP_yUp;
-            
-            V2 boardPosAt = V4MultMat4(v4(pos.x, pos.y, 1, 1), params->pixelsToMeters).xy;
-            boardPosAt.x += cameraPos.x;
-            boardPosAt.y += cameraPos.y;
-            boardPosAt.x = (int)(clamp(0, boardPosAt.x, params->boardWidth - 1) + 0.5f);
-            boardPosAt.y = (int)(clamp(0, boardPosAt.y, params->boardHeight -1) + 0.5f);
-
-            if(shapeStillConnected(shape, params->currentHotIndex, boardPosAt, params)) {
-                V2 oldPos = shape->coords[params->currentHotIndex];
-                V2 newPos = boardPosAt;
-                assert(getBoardState(params, oldPos) == BOARD_SHAPE);
-                setBoardState(params, oldPos, BOARD_NULL, BOARD_VAL_TRANSIENT);    
-                setBoardState(params, newPos, BOARD_SHAPE, BOARD_VAL_TRANSIENT);    
-                shape->coords[params->currentHotIndex] = newPos;
-            }
-        }
-
-    }
-}
-
-Texture *getBoardTex(BoardValue *boardVal, BoardState boardState, FrameParams *params) {
+Texture *getBoardTex(BoardValType boardValType, BoardState boardState, FrameParams *params) {
     Texture *tex = 0;
     if(boardState != BOARD_NULL) {
         switch(boardState) {
             case BOARD_STATIC: {
-                if(boardVal->type == BOARD_VAL_OLD) {
+                if(boardValType == BOARD_VAL_OLD) {
                     tex = params->metalTex;
                     assert(tex);
-                } else if(boardVal->type == BOARD_VAL_ALWAYS) {
+                } else if(boardValType == BOARD_VAL_ALWAYS) {
                     tex = params->woodTex;
                     assert(tex);
                 } else {
@@ -693,55 +149,90 @@ Texture *getBoardTex(BoardValue *boardVal, BoardState boardState, FrameParams *p
     return tex;
 }
 
-void updateBoardWinState(FrameParams *params) {
-    int winCount = 0;
-    for(int boardY = 0; boardY < params->boardHeight; ++boardY) {
-        bool win = true;
-        for(int boardX = 0; boardX < params->boardWidth; ++boardX) {
-            BoardValue *boardVal = &params->board[boardY*params->boardWidth + boardX];
-            if(boardVal->state == BOARD_NULL || boardVal->state == BOARD_SHAPE) {
-                win = false;
-                break;
-            } 
-            assert(boardVal->state != BOARD_INVALID);
-        }
-        if(win) {
-            winCount++;
-            for(int boardX = 0; boardX < params->boardWidth; ++boardX) {
-                BoardValue *boardVal = &params->board[boardY*params->boardWidth + boardX];
-                if(boardVal->state == BOARD_STATIC && boardVal->type == BOARD_VAL_OLD) {
-                    setBoardState(params, v2(boardX, boardY), BOARD_NULL, BOARD_VAL_OLD);
-                }
-            }
-            playSound(params->soundArena, params->successSound, 0, AUDIO_FOREGROUND);
-        }
-    }
-    params->experiencePoints += sqr(winCount)*100;
+//NOTE: Every cell shares boardToScreen, so the render group only multiplies it once a frame.
+static inline void drawBoardCell(FrameParams *params, Texture *tex, int boardX, int boardY, float zAt, V4 color) {
+    renderTextureCentreDim(tex, v3(boardX, boardY, zAt), v2(1, 1), color, 0, mat4(), mat4(), params->boardToScreen);
 }
 
-void initBoard(Arena *longTermArena, FrameParams *params, int boardWidth, int boardHeight, LevelType levelType, int blockCount, bool createArray) {
-    params->boardWidth = boardWidth;
-    params->boardHeight = boardHeight;
-
-    params->lifePoints = params->lifePointsMax;
-    if(createArray) {
-        params->board = pushArray(longTermArena, params->boardWidth*params->boardHeight, BoardValue);
-    } 
-
-    for(int boardY = 0; boardY < params->boardHeight; ++boardY) {
-        for(int boardX = 0; boardX < params->boardWidth; ++boardX) {
-            BoardValue *boardVal = &params->board[boardY*params->boardWidth + boardX];
-
-            boardVal->type = BOARD_VAL_NULL;
-            boardVal->state = BOARD_NULL;
-            boardVal->prevState = BOARD_NULL;
+//NOTE: The cell backgrounds and the STATIC & EXPLOSIVE cells that aren't fading, everything else is drawn each frame.
+void updateBoardLayer(FrameParams *params, BoardCellRect visible) {
+    GameState *game = &params->game;
+    BoardMasks *masks = &game->masks;
+    BoardLayer *layer = &params->boardLayer;
+    V2 resolution = *params->resolution;
 
-            boardVal->fadeTimer.value = -1;
-            boardVal->color = COLOR_WHITE;
+    bool redrawAll = (!layer->valid || !v2Equal(layer->cameraPos, params->camera.pos) || layer->zoom != params->camera.zoom);
+    int minY = visible.minY;
+    int maxY = visible.maxY;
+    if(!redrawAll) {
+        minY = visible.maxY + 1;
+        maxY = visible.minY - 1;
+        for(int boardY = visible.minY; boardY <= visible.maxY; ++boardY) {
+            if(isLayerRowChanged(masks, boardY)) {
+                if(boardY < minY) { minY = boardY; }
+                maxY = boardY;
+            }
+        }
+    }
+    //NOTE: rows off screen get drawn when the camera moves onto them, that redraws everything
+    clearLayerRows(masks);
+    layer->redrawnRowCount = 0;
+    if(!redrawAll && minY > maxY) {
+        return;
+    }
+
+    //NOTE: the layer gets its own render group so none of the frame's items are drawn into it
+    RenderGroup frameGroup = globalRenderGroup;
+    globalRenderGroup = initRenderGroup();
+    if(!redrawAll) {
+        //NOTE: only clear & draw the pixels of the rows that changed. Pixels with 0 in the middle of the screen.
+        float bottom = calculateRenderInfo(v3(0, minY - 0.5f, 0), v3(1, 1, 1), params->cameraPos, params->boardToPixels).transformPos.y;
+        float top = calculateRenderInfo(v3(0, maxY + 0.5f, 0), v3(1, 1, 1), params->cameraPos, params->boardToPixels).transformPos.y;
+        int scissorY = (int)floorf(bottom + 0.5f*resolution.y);
+        int scissorHeight = (int)ceilf(top + 0.5f*resolution.y) - scissorY;
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(0, scissorY, (int)resolution.x, scissorHeight);
+        //NOTE: the rows either side can share the pixels on the edges, draw them again too. The scissor keeps them
+        //from being blended over what is already there.
+        minY = (int)max(visible.minY, minY - 1);
+        maxY = (int)min(visible.maxY, maxY + 1);
+    }
+    clearBufferAndBind(layer->frameBuffer.bufferId, COLOR_NULL);
+    renderDisableDepthTest(&globalRenderGroup);
+    BoardCellRect redrawn = visible;
+    redrawn.minY = minY;
+    redrawn.maxY = maxY;
+    BoardArrays *board = &game->board;
+    for(int chunkY = minY >> BOARD_CHUNK_SHIFT; chunkY <= (maxY >> BOARD_CHUNK_SHIFT) && visible.minX <= visible.maxX; ++chunkY) {
+        for(int chunkX = visible.minX >> BOARD_CHUNK_SHIFT; chunkX <= (visible.maxX >> BOARD_CHUNK_SHIFT); ++chunkX) {
+            //NOTE: a chunk that was never made is all empty, only the backgrounds
+            BoardChunk *chunk = board->chunks[chunkY*board->chunkCountX + chunkX];
+            BoardCellRect cells = getChunkCellRect(chunkX, chunkY, redrawn);
+            for(int boardY = cells.minY; boardY <= cells.maxY; ++boardY) {
+                for(int boardX = cells.minX; boardX <= cells.maxX; ++boardX) {
+                    drawBoardCell(params, params->boarderTex, boardX, boardY, -3, COLOR_WHITE);
+                    if(!chunk) {
+                        continue;
+                    }
+                    int boardIndex = boardY*game->boardWidth + boardX;
+                    int cellIndex = getChunkCellIndex(boardX, boardY);
+                    BoardState state = (BoardState)board->states[boardIndex];
+                    if(isFilledState(state) && chunk->fadeSlots[cellIndex] < 0) {
+                        Texture *tex = getBoardTex((BoardValType)board->types[boardIndex], state, params);
+                        drawBoardCell(params, tex, boardX, boardY, -2, chunk->colors[cellIndex]);
+                    }
+                }
+            }
         }
     }
+    drawRenderGroup(&globalRenderGroup);
+    glDisable(GL_SCISSOR_TEST);
+    globalRenderGroup = frameGroup;
 
-    createLevel(params, blockCount, levelType);
+    layer->valid = true;
+    layer->cameraPos = params->camera.pos;
+    layer->zoom = params->camera.zoom;
+    layer->redrawnRowCount = (maxY - minY) + 1;
 }
 
 typedef struct {
@@ -754,9 +245,8 @@ void transitionCallbackForLevel(void *data_) {
     TransitionDataLevel *trans = (TransitionDataLevel *)data_;
     FrameParams *params = trans->params;
 
-    initBoard(params->longTermArena, params, params->boardWidth, params->boardHeight, trans->levelType, trans->blockCount, false);
-    params->createShape = true;   
-    params->lifePoints = params->lifePointsMax;
+    recordReplayRestart(&params->replay, trans->levelType, trans->blockCount);
+    restartLevel(&params->game, trans->levelType, trans->blockCount);
 } 
 
 void setLevelTransition(FrameParams *params,  int blockCount, LevelType levelType) {
@@ -767,91 +257,102 @@ void setLevelTransition(FrameParams *params,  int blockCount, LevelType levelTyp
     setTransition_(&params->transitionState, transitionCallbackForLevel, data);
 }
 
-void updateWindmillSide(FrameParams *params, V2 pos, int max, int *count_, bool *isOut_, bool *axis_) {
-    int count = *count_;
-    bool isOut = *isOut_;
-    bool axis = *axis_;
-
-    V2 shift = v2(0, 0);
-    BoardState stateToSet = BOARD_NULL;
-    if(isOut) {
-        count++;
-        if(axis) { shift = v2(count, 0); } //is xAxis
-        if(!axis) { shift = v2(0, count); } //is xyAxis
-        stateToSet = BOARD_STATIC;
-    } else {
-        if(axis) { shift = v2(count, 0); } //is xAxis
-        if(!axis) { shift = v2(0, count); } //is xAxis
-        count--;
-    }
-
-    V2 newPos = v2_plus(pos, shift);
-
-    if(getBoardState(params, newPos) != BOARD_NULL && stateToSet == BOARD_STATIC) {
-        isOut = false;
-    }
-    if(inBoardBounds(params, newPos)) {
-        if((getBoardState(params, newPos) == BOARD_NULL && stateToSet == BOARD_STATIC) || stateToSet == BOARD_NULL) {
-            setBoardState(params, newPos, stateToSet, BOARD_VAL_ALWAYS);
+//NOTE: Takes the frame's game events. Each kind of event plays its sound once a frame however many of it there were,
+//so three explosives going off together is one bang.
+void consumeGameEvents(FrameParams *params) {
+    bool played[GAME_EVENT_TYPE_COUNT] = {};
+    GameEvent event;
+    while(popGameEvent(&params->game.events, &event)) {
+        if(played[event.type]) {
+            continue;
         }
-    } else {
-        isOut = false;
-        count--;
+        played[event.type] = true;
+        WavFile *wavFile = 0;
+        switch(event.type) {
+            case GAME_EVENT_MOVED: {
+                wavFile = params->moveSound;
+            } break;
+            case GAME_EVENT_SOLIDIFIED: {
+                wavFile = params->solidfyShapeSound;
+            } break;
+            case GAME_EVENT_ROW_CLEARED: {
+                wavFile = params->successSound;
+            } break;
+            case GAME_EVENT_EXPLODED: {
+                wavFile = params->explosiveSound;
+            } break;
+            default: {
+                assert(!"not handled");
+            }
+        }
+        playSound(params->soundArena, wavFile, 0, AUDIO_FOREGROUND);
     }
+}
 
-    if(count == max) {
-        isOut = false;
-    }
-    if(count == 0) {
-        axis = !axis;
-        isOut = true;
-        count = 0;
+GameInput getGameInput(FrameParams *params) {
+    GameInput input = {};
+    for(int buttonIndex = 0; buttonIndex < BUTTON_COUNT; ++buttonIndex) {
+        input.buttons[buttonIndex] = gameButtons[buttonIndex];
     }
-    *count_ = count;
-    *axis_ = axis;
-    *isOut_ = isOut;
+    V2 mouseP = params->keyStates->mouseP_yUp;
+    V2 mouseMetres = V4MultMat4(v4(mouseP.x, mouseP.y, 1, 1), params->pixelsToMeters).xy;
+    input.mouseBoardP = getMouseBoardCell(screenToBoardP(&params->camera, mouseMetres));
+    return input;
 }
 
 void renderXPBarAndHearts(FrameParams *params, V2 resolution) {
+    GameState *game = &params->game;
     float heartDim = 0.6f;
-    float across = params->lifePointsMax*heartDim / 2;
-    float heartY = params->boardHeight;
-    float xAt = 0.5f*params->boardWidth - across;
-    for(int heartIndex = 0; heartIndex < params->lifePointsMax; ++heartIndex) {
+    float across = game->lifePointsMax*heartDim / 2;
+    float heartY = game->boardHeight;
+    float xAt = 0.5f*game->boardWidth - across;
+    for(int heartIndex = 0; heartIndex < game->lifePointsMax; ++heartIndex) {
         Texture *heartTex = 0;
-        if(params->lifePoints <= heartIndex) { 
+        if(game->lifePoints <= heartIndex) { 
             heartTex = params->heartEmptyTex;
         } else {
             heartTex = params->heartFullTex;
         }
-        RenderInfo renderInfo = calculateRenderInfo(v3(xAt, heartY, -2), v3_scale(heartDim, v3(1, 1, 1)), params->cameraPos, params->metresToPixels);
+        RenderInfo renderInfo = calculateRenderInfo(v3(xAt, heartY, -2), v3_scale(heartDim, v3(1, 1, 1)), params->cameraPos, params->boardToPixels);
         renderTextureCentreDim(heartTex, renderInfo.pos, renderInfo.dim.xy, COLOR_WHITE, 0, mat4(), renderInfo.pvm, OrthoMatrixToScreen(resolution.x, resolution.y));                    
         xAt += heartDim;
     }
 
     float barHeight = 0.4f;
     float maxExperiencePoints = 500;
-    float ratioXp = clamp01(params->experiencePoints / maxExperiencePoints);
+    float ratioXp = clamp01(game->experiencePoints / maxExperiencePoints);
     float startXp = -0.5f; //move back half a square
-    float halfXp = 0.5f*params->boardWidth;
-    float xpWidth = ratioXp*params->boardWidth;
-    RenderInfo renderInfo = calculateRenderInfo(v3(startXp + 0.5f*xpWidth, -2*barHeight, -2), v3_scale(1, v3(xpWidth, barHeight, 1)), params->cameraPos, params->metresToPixels);
+    float halfXp = 0.5f*game->boardWidth;
+    float xpWidth = ratioXp*game->boardWidth;
+    RenderInfo renderInfo = calculateRenderInfo(v3(startXp + 0.5f*xpWidth, -2*barHeight, -2), v3_scale(1, v3(xpWidth, barHeight, 1)), params->cameraPos, params->boardToPixels);
     renderDrawRectCenterDim(renderInfo.pos, renderInfo.dim.xy, COLOR_GREEN, 0, mat4(), Mat4Mult(OrthoMatrixToScreen(resolution.x, resolution.y), renderInfo.pvm)); 
 
-    renderInfo = calculateRenderInfo(v3(startXp + halfXp, -2*barHeight, -2), v3_scale(1, v3(params->boardWidth, barHeight, 1)), params->cameraPos, params->metresToPixels);
+    renderInfo = calculateRenderInfo(v3(startXp + halfXp, -2*barHeight, -2), v3_scale(1, v3(game->boardWidth, barHeight, 1)), params->cameraPos, params->boardToPixels);
     renderDrawRectOutlineCenterDim(renderInfo.pos, renderInfo.dim.xy, COLOR_BLACK, 0, mat4(), Mat4Mult(OrthoMatrixToScreen(resolution.x, resolution.y), renderInfo.pvm)); 
 }
 
 void gameUpdateAndRender(void *params_) {
     FrameParams *params = (FrameParams *)params_;
+    GameState *game = &params->game;
     V2 screenDim = *params->screenDim;
     V2 resolution = *params->resolution;
     V2 middleP = v2_scale(0.5f, resolution);
-    //ceneter the camera
-    params->cameraPos.xy = v2_scale(0.5f, v2((float)params->boardWidth - 1, (float)params->boardHeight - 1));
+
+    //NOTE: half the screen in board cells at a zoom of 1
+    V2 halfViewMetres = V4MultMat4(v4(0.5f*resolution.x, 0.5f*resolution.y, 1, 1), params->pixelsToMeters).xy;
+    V2 mouseP = params->keyStates->mouseP_yUp;
+    V2 mouseMetres = V4MultMat4(v4(mouseP.x, mouseP.y, 1, 1), params->pixelsToMeters).xy;
+    updateBoardCamera(&params->camera, halfViewMetres, mouseMetres, params->keyStates->scrollWheelY,
+                      isDown(gameButtons, BUTTON_RIGHT_MOUSE), game->boardWidth, game->boardHeight);
+    params->cameraPos.xy = params->camera.pos;
+    params->boardToPixels = Mat4Mult(params->metresToPixels, Matrix4_scale(mat4(), v3(params->camera.zoom, params->camera.zoom, 1)));
+    params->boardToScreen = Mat4Mult(OrthoMatrixToScreen(resolution.x, resolution.y), Mat4Mult(params->boardToPixels, Matrix4_translate(mat4(), v3_scale(-1, params->cameraPos))));
 
     //make this platform independent
     easyOS_beginFrame(resolution);
+    if(wasPressed(gameButtons, BUTTON_F1)) {
+        params->showRenderStats = !params->showRenderStats;
+    }
     //////CLEAR BUFFERS
     // 
     clearBufferAndBind(params->backbufferId, COLOR_BLACK);
@@ -866,95 +367,105 @@ void gameUpdateAndRender(void *params_) {
     bool transitioning = updateTransitions(&params->transitionState, resolution, params->dt);
     if(!transitioning && isPlayState) {
         //if updating a transition don't update the game logic, just render the game board. 
-        if(params->createShape || !params->lifePoints) {
-            params->currentShape.count = 0;
-            bool retryLevel = !params->lifePoints;
-            for (int i = 0; i < 4 && !retryLevel; ++i) {
-                int xAt = i % params->boardWidth;
-                int yAt = (params->boardHeight - 1) - (i / params->boardWidth);
-                params->currentShape.coords[params->currentShape.count++] = v2(xAt, yAt);
-                V2 pos = v2(xAt, yAt);
-                if(getBoardState(params, pos) != BOARD_NULL) {
-                    //at the top of the board
-                    retryLevel = true;
-                    break;
-                    //
-                } else {
-                    setBoardState(params, pos, BOARD_SHAPE, BOARD_VAL_TRANSIENT);    
-                }
-            }
-            if(retryLevel) {
-                setLevelTransition(params, params->currentBlockCount, params->currentLevelType);
-            }
-
-            params->moveTimer.value = 0;
-            params->createShape = false;
+        GameInput input = getGameInput(params);
+        recordReplayFrame(&params->replay, &input, params->dt);
+        stepGame(game, &input, params->dt);
+        consumeGameEvents(params);
+        if(game->retryLevel) {
+            setLevelTransition(params, game->currentBlockCount, game->currentLevelType);
         }
-
-        for(int extraIndex = 0; extraIndex < params->extraShapeCount; ++extraIndex) {
-            ExtraShape *extraShape = params->extraShapes + extraIndex;
-            switch(extraShape->type) {
-                case SHAPE_WINDMILL: {
-                    TimerReturnInfo info = updateTimer(&extraShape->timer, params->dt);
-                    if(info.finished) {
-                        turnTimerOn(&extraShape->timer);
-                        if(extraShape->onX) {
-                            updateWindmillSide(params, extraShape->pos, extraShape->xMax, &extraShape->count, &extraShape->isOut, &extraShape->onX);
-                        } else {
-                            updateWindmillSide(params, extraShape->pos, extraShape->yMax, &extraShape->count, &extraShape->isOut, &extraShape->onX);
-                        }
-                        
-                    }
-                } break;
-            }
-        }
-        updateAndRenderShape(&params->currentShape, params->cameraPos, resolution, screenDim, params->metresToPixels, params);
-        updateBoardWinState(params);
     }
 
     //Stil render when we are in a transition
     if(isPlayState) {
         renderXPBarAndHearts(params, resolution);
-        for(int boardY = 0; boardY < params->boardHeight; ++boardY) {
-            for(int boardX = 0; boardX < params->boardWidth; ++boardX) {
-                RenderInfo bgRenderInfo = calculateRenderInfo(v3(boardX, boardY, -3), v3(1, 1, 1), params->cameraPos, params->metresToPixels);
-                BoardValue *boardVal = &params->board[boardY*params->boardWidth + boardX];
-                renderTextureCentreDim(params->boarderTex, bgRenderInfo.pos, bgRenderInfo.dim.xy, COLOR_WHITE, 0, mat4(), mat4(), Mat4Mult(OrthoMatrixToScreen(resolution.x, resolution.y), bgRenderInfo.pvm));            
-                
-                if(!(boardVal->prevState == BOARD_NULL && boardVal->state == BOARD_NULL)) {
-                    V4 currentColor = boardVal->color;
-                    if(isOn(&boardVal->fadeTimer)) {
-                        TimerReturnInfo timeInfo = updateTimer(&boardVal->fadeTimer, params->dt);
-                            
-                        float lerpT = timeInfo.canonicalVal;
-                        V4 prevColor = lerpV4(boardVal->color, clamp01(lerpT), COLOR_NULL);
-                        currentColor = lerpV4(COLOR_NULL, lerpT, boardVal->color);
-
-                        RenderInfo prevRenderInfo = calculateRenderInfo(v3(boardX, boardY, -1), v3(1, 1, 1), params->cameraPos, params->metresToPixels);
-
-                        Texture *tex = getBoardTex(boardVal, boardVal->prevState, params);
-                        if(tex) {
-                            renderTextureCentreDim(tex, prevRenderInfo.pos, prevRenderInfo.dim.xy, prevColor, 0, mat4(), mat4(), Mat4Mult(OrthoMatrixToScreen(resolution.x, resolution.y), prevRenderInfo.pvm));            
-                        }    
-
-                        if(timeInfo.finished) {
-                            boardVal->prevState = boardVal->state;
-                        }
+        BoardArrays *board = &game->board;
+        //NOTE: show where the held block can go
+        bool showDragTargets = (game->currentHotIndex >= 0);
+        if(showDragTargets) {
+            updateDragTargetMap(game, &game->currentShape);
+        }
+        BoardCellRect visible = getVisibleBoardCells(&params->camera, halfViewMetres, game->boardWidth, game->boardHeight);
+        updateBoardFades(game, params->dt, visible);
+        updateBoardLayer(params, visible);
+        renderTextureCentreDim(&params->boardLayer.texture, v3(0, 0, -3.5f), resolution, COLOR_WHITE, 0, mat4(), mat4(), OrthoMatrixToScreen(resolution.x, resolution.y));
+
+        //NOTE: everything not in the layer, only where it is on screen
+        if(showDragTargets) {
+            DragTargetMap *map = &game->dragTargets;
+            for(int mapY = 0; mapY < DRAG_TARGET_MAP_SIZE; ++mapY) {
+                for(uint32_t bits = map->rows[mapY]; bits; bits &= bits - 1) {
+                    int boardX = map->minX + countTrailingZeros64(bits);
+                    int boardY = map->minY + mapY;
+                    if(boardX >= visible.minX && boardX <= visible.maxX && boardY >= visible.minY && boardY <= visible.maxY) {
+                        drawBoardCell(params, params->boarderTex, boardX, boardY, -3, COLOR_GREEN);
+                    }
+                }
+            }
+        }
+
+        //NOTE: the fading cells and the blocks of the shapes, a chunk on screen at a time
+        BoardMasks *masks = &game->masks;
+        for(int chunkY = visible.minY >> BOARD_CHUNK_SHIFT; chunkY <= (visible.maxY >> BOARD_CHUNK_SHIFT) && visible.minX <= visible.maxX; ++chunkY) {
+            for(int chunkX = visible.minX >> BOARD_CHUNK_SHIFT; chunkX <= (visible.maxX >> BOARD_CHUNK_SHIFT); ++chunkX) {
+                //NOTE: anything that isn't empty has been set, which made its chunk
+                BoardChunk *chunk = board->chunks[chunkY*board->chunkCountX + chunkX];
+                if(!chunk) {
+                    continue;
+                }
+                BoardCellRect cells = getChunkCellRect(chunkX, chunkY, visible);
+
+                for(int fadeIndex = 0; fadeIndex < chunk->fadingCount; ++fadeIndex) {
+                    int cellIndex = chunk->fadingCells[fadeIndex];
+                    int boardX = (chunkX << BOARD_CHUNK_SHIFT) + (cellIndex & (BOARD_CHUNK_SIZE - 1));
+                    int boardY = (chunkY << BOARD_CHUNK_SHIFT) + (cellIndex >> BOARD_CHUNK_SHIFT);
+                    if(boardX < cells.minX || boardX > cells.maxX || boardY < cells.minY || boardY > cells.maxY) {
+                        continue;
                     }
-                        
-                    Texture *tex = getBoardTex(boardVal, boardVal->state, params);
+                    int boardIndex = boardY*game->boardWidth + boardX;
+                    BoardValType type = (BoardValType)board->types[boardIndex];
+                    V4 color = chunk->colors[cellIndex];
+                    float lerpT = getTimerValue01(&chunk->fadeTimers[cellIndex]);
+                    V4 prevColor = lerpV4(color, clamp01(lerpT), COLOR_NULL);
+                    V4 currentColor = lerpV4(COLOR_NULL, lerpT, color);
+
+                    Texture *tex = getBoardTex(type, (BoardState)chunk->prevStates[cellIndex], params);
                     if(tex) {
-                        RenderInfo currentStateRenderInfo = calculateRenderInfo(v3(boardX, boardY, -2), v3(1, 1, 1), params->cameraPos, params->metresToPixels);
-                        renderTextureCentreDim(tex, currentStateRenderInfo.pos, currentStateRenderInfo.dim.xy, currentColor, 0, mat4(), mat4(), Mat4Mult(OrthoMatrixToScreen(resolution.x, resolution.y), currentStateRenderInfo.pvm));            
+                        drawBoardCell(params, tex, boardX, boardY, -1, prevColor);
+                    }
+                    tex = getBoardTex(type, (BoardState)board->states[boardIndex], params);
+                    if(tex) {
+                        drawBoardCell(params, tex, boardX, boardY, -2, currentColor);
+                    }
+                }
+
+                //NOTE: the shape blocks that aren't fading, a row of the shape mask at a time
+                uint64_t columnMask = ((uint64_t)1 << (cells.maxX - cells.minX + 1)) - 1;
+                for(int boardY = cells.minY; boardY <= cells.maxY; ++boardY) {
+                    for(uint64_t bits = getMaskRowBits(masks, masks->shapeRows, boardY, cells.minX) & columnMask; bits; bits &= bits - 1) {
+                        int boardX = cells.minX + countTrailingZeros64(bits);
+                        int cellIndex = getChunkCellIndex(boardX, boardY);
+                        if(chunk->fadeSlots[cellIndex] >= 0) {
+                            continue;
+                        }
+                        int boardIndex = boardY*game->boardWidth + boardX;
+                        Texture *tex = getBoardTex((BoardValType)board->types[boardIndex], BOARD_SHAPE, params);
+                        drawBoardCell(params, tex, boardX, boardY, -2, chunk->colors[cellIndex]);
                     }
-                } else {
-                    assert(!isOn(&boardVal->fadeTimer));
                 }
             }
         }
     }
     
 
+    if(params->showRenderStats) {
+        //NOTE: the frame before this one, this frame's are still being counted
+        RenderStats *stats = &globalLastRenderStats;
+        char statsText[256];
+        snprintf(statsText, arrayCount(statsText), "draw calls %d, shader name lookups %d, gl state calls %d issued %d skipped", stats->drawCalls, stats->shaderNameLookups, stats->glStateCallsIssued, stats->glStateCallsSkipped);
+        outputText(params->font, 10, 40, -1, resolution, statsText, rect2f(0, 0, resolution.x, resolution.y), COLOR_BLACK, 0.25f, true);
+    }
+
     // outputText(params->font, 0, 400, -1, resolution, "hey˙  हिन् दी df ©˙ \n∆˚ ", rect2f(0, 0, resolution.x, resolution.y), COLOR_BLACK, 1, true);
    drawRenderGroup(&globalRenderGroup);
    
@@ -1002,7 +513,6 @@ int main(int argc, char *args[]) {
     params.solidfyShapeSound = findSoundAsset("slate_sound.wav");
     params.successSound = findSoundAsset("Success2.wav");
     params.explosiveSound = findSoundAsset("explosion.wav");
-    params.experiencePoints = 100;
 
 #if 0 //particle system in background. Was to distracting. 
     particle_system_settings particleSet = InitParticlesSettings(PARTICLE_SYS_DEFAULT);
@@ -1019,7 +529,7 @@ int main(int argc, char *args[]) {
     particleSet.pressureAffected = false;
 
 
-    InitParticleSystem(&params.particleSystem, &particleSet);
+    InitParticleSystem(&params.particleSystem, &particleSet, (uint64_t)time(NULL));
     params.particleSystem.viewType = ORTHO_MATRIX;
     setParticleLifeSpan(&params.particleSystem, 10.0f);
     Reactivate(&params.particleSystem);
@@ -1039,11 +549,16 @@ int main(int argc, char *args[]) {
     params.soundArena = &soundArena;
     params.longTermArena = &longTermArena;
     params.dt = dt;
-    params.slowTimeFactor = 1.0f;
     params.windowHandle = appInfo.windowHandle;
     params.backbufferId = appInfo.frameBackBufferId;
     params.renderbufferId = appInfo.renderBackBufferId;
     params.mainFrameBuffer = createFrameBuffer(resolution.x, resolution.y, FRAMEBUFFER_DEPTH | FRAMEBUFFER_STENCIL);
+    //NOTE: the layer is drawn back to front without a depth test, so it doesn't need a depth buffer
+    params.boardLayer.frameBuffer = createFrameBuffer(resolution.x, resolution.y, 0);
+    params.boardLayer.texture.id = params.boardLayer.frameBuffer.textureId;
+    params.boardLayer.texture.width = (int)resolution.x;
+    params.boardLayer.texture.height = (int)resolution.y;
+    params.boardLayer.texture.uvCoords = rect2f(0, 0, 1, 1);
     params.resolution = &resolution;
     params.screenDim = &screenDim;
     params.metresToPixels = setupInfo.metresToPixels;
@@ -1054,14 +569,24 @@ int main(int argc, char *args[]) {
     params.screenRelativeSize = setupInfo.screenRelativeSize;
         
     int blockCount = 7;
-    initBoard(&longTermArena, &params, BOARD_WIDTH, BOARD_HEIGHT, START_LEVEL, blockCount, true);
-    params.currentBlockCount = blockCount;
-    params.currentLevelType = START_LEVEL; //this is from the defines file
-    params.lifePointsMax = 3;
-    params.lifePoints = params.lifePointsMax;
-    
-    params.createShape = true;
-    params.moveTimer = initTimer(1.0f);
+    RandomSeries gameRandom = initRandomSeries((uint64_t)time(NULL));
+    //NOTE: without the level file the levels are made randomly, like before it existed
+    char *levelFileName = concat(globalExeBasePath, LEVEL_FILE_NAME);
+    params.levels = loadLevelFile(&longTermArena, levelFileName);
+    if(params.levels.valid) {
+        params.game.levels = &params.levels;
+    }
+    //NOTE: without the shape file only the built in shapes spawn
+    char *shapeFileName = concat(globalExeBasePath, SHAPE_FILE_NAME);
+    params.shapes = defaultShapeCatalogue;
+    loadShapeCatalogue(shapeFileName, &params.shapes);
+    params.game.shapes = &params.shapes;
+    char *replayFileName = concat(globalExeBasePath, REPLAY_FILE_NAME);
+    beginReplayRecording(&params.replay, replayFileName, BOARD_WIDTH, BOARD_HEIGHT, START_LEVEL, blockCount, gameRandom,
+                         params.levels.valid ? params.levels.hash : 0, params.shapes.hash);
+    initGame(&params.game, &longTermArena, BOARD_WIDTH, BOARD_HEIGHT, START_LEVEL, blockCount, gameRandom); //START_LEVEL is from the defines file
+    initUndoRing(&params.undoRing, BOARD_WIDTH, BOARD_HEIGHT, UNDO_SNAPSHOT_COUNT);
+    params.game.undo = &params.undoRing;
     params.woodTex = woodTex;
     params.stoneTex = stoneTex;
     params.metalTex = metalTex;
@@ -1071,9 +596,9 @@ int main(int argc, char *args[]) {
     params.heartEmptyTex = heartEmptyTex;
     params.bgTex = bgTex;
     params.lastTime = SDL_GetTicks();
-    params.currentHotIndex = -1;
 
     params.cameraPos = v3(0, 0, 0);
+    params.camera = initBoardCamera(BOARD_WIDTH, BOARD_HEIGHT);
 
     TransitionState transState = {};
     transState.transitionSound = findSoundAsset("click.wav");
@@ -1108,6 +633,7 @@ int main(int argc, char *args[]) {
       gameUpdateAndRender(&params);
 #endif
     }
+    endReplayRecording(&params.replay, &params.game);
     easyOS_endProgram(&appInfo);
 	}
     return 0;
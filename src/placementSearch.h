@@ -0,0 +1,563 @@
+/*
+    Finds every place the current shape can end up, for hints and for checking a level can be beaten. Starting from
+    where the shape is now it tries every move the player has: going down (and left & right when the arrow keys are
+    allowed) the same as moveShape, and dragging a block anywhere shapeStillConnected allows. A shape that can't go
+    down any more is a placement, and each placement is scored by how the board looks once the shape goes solid.
+
+    A search state is the cells of the shape plus the explosives it has blown up, the rest of the board is the same
+    for the whole search. States are keyed by a Zobrist hash (the game's keys for each shape cell and each blown up
+    explosive xored together) and kept in a transposition table, so a state is only expanded once however it was reached.
+
+    Threads: the moves out of the root are dealt out to the threads round robin, then each thread works through its
+    own queue. The transposition table is shared and lock free (a key goes in with one compare and swap), so a state
+    one thread has found isn't expanded again by another. The nodes are one array the threads take slots from with an
+    atomic add, which is also the node budget.
+
+    The board is treated as still while searching, the windmills on LEVEL_4 don't move.
+
+    Usage:
+        PlacementSearchResult result = searchPlacements(game, &game->currentShape, getDefaultPlacementSearchSettings(), arena);
+        result.placements[0] is the best placement, getPlacementPath gives the moves to get there.
+*/
+#include <thread>
+#include <atomic>
+
+#define MAX_PLACEMENT_THREADS 64
+#define PLACEMENT_MOVE_DRAG (MOVE_DOWN + 1) //PlacementMove.moveType is a MoveType or this
+
+//NOTE: What the scores are made from. Lines are what the player gets points for, the rest is how messy the board is left.
+#define PLACEMENT_SCORE_LINE 100 //times lines cleared squared, the same as the experience points
+#define PLACEMENT_SCORE_EXPLOSIVE -40
+#define PLACEMENT_SCORE_HOLE -8
+#define PLACEMENT_SCORE_HEIGHT -2
+#define PLACEMENT_SCORE_BUMPINESS -1
+#define PLACEMENT_SCORE_BLOCKS_SPAWN -100000 //the next shape can't spawn so the level fails
+
+typedef struct {
+    int moveType; //a MoveType or PLACEMENT_MOVE_DRAG
+    V2 from; //the block that gets dragged, only for PLACEMENT_MOVE_DRAG
+    V2 to; //where the block gets dragged to, only for PLACEMENT_MOVE_DRAG
+} PlacementMove;
+
+typedef struct {
+    uint64_t key;
+    int parentIndex; //-1 for the root
+
+    //NOTE: how we got here from the parent, moveFrom & moveTo are board indexes
+    int moveType;
+    int moveFrom;
+    int moveTo;
+
+    int count;
+    int cells[MAX_SHAPE_COUNT]; //board indexes of the shape blocks
+    int destroyedCount;
+    int destroyed[MAX_SHAPE_COUNT]; //board indexes of the explosives the shape blew up. Each one took a block and a life.
+} PlacementNode;
+
+typedef struct {
+    int nodeIndex;
+    uint64_t key;
+
+    int count;
+    V2 coords[MAX_SHAPE_COUNT];
+
+    int explosivesHit;
+    int linesCleared;
+    int holes; //empty cells with a filled cell somewhere above them
+    int maxHeight;
+    int bumpiness; //sum of the height differences between next door columns
+    bool blocksSpawn;
+
+    int score;
+} Placement;
+
+typedef struct {
+    int maxNodes;
+    int threadCount; //0 uses every core
+    bool allowSideMoves;
+} PlacementSearchSettings;
+
+typedef struct {
+    Placement *placements; //best first
+    int placementCount;
+
+    PlacementNode *nodes; //what getPlacementPath walks back through
+    int nodeCount;
+    int ttHits; //moves that led to a state we had already found
+    bool hitNodeLimit; //ran out of nodes, so there could be placements we didn't find
+} PlacementSearchResult;
+
+typedef struct {
+    int *queue;
+    int queueStart;
+    int queueEnd;
+    int ttHits;
+
+    char padding[64]; //keep the workers off each other's cache lines
+} PlacementWorker;
+
+typedef struct {
+    GameState *game;
+    PlacementSearchSettings settings;
+    int livesLeft;
+
+    std::atomic<uint64_t> *tableKeys; //0 is an empty slot
+    uint32_t tableMask;
+
+    PlacementNode *nodes;
+    std::atomic<int> nodeCount;
+    std::atomic<bool> hitNodeLimit;
+
+    int *placementNodes;
+    std::atomic<int> placementCount;
+
+    int threadCount;
+    PlacementWorker *workers;
+} PlacementSearch;
+
+static inline PlacementSearchSettings getDefaultPlacementSearchSettings() {
+    PlacementSearchSettings result = {};
+    result.maxNodes = 1 << 14;
+    result.threadCount = 1;
+    result.allowSideMoves = CAN_MOVE_WITH_ARROW_KEYS;
+    return result;
+}
+
+//NOTE: Returns true if the key wasn't in the table yet. The table is always less than half full so this finishes.
+static bool insertPlacementKey(PlacementSearch *search, uint64_t key) {
+    if(key == 0) {
+        key = 1;
+    }
+    uint32_t slot = (uint32_t)key & search->tableMask;
+    for(;;) {
+        uint64_t slotKey = search->tableKeys[slot].load(std::memory_order_relaxed);
+        if(slotKey == key) {
+            return false;
+        }
+        if(slotKey == 0) {
+            if(search->tableKeys[slot].compare_exchange_strong(slotKey, key, std::memory_order_relaxed)) {
+                return true;
+            }
+            //NOTE: another thread got this slot first, slotKey is what it put there so look at the slot again
+            continue;
+        }
+        slot = (slot + 1) & search->tableMask;
+    }
+}
+
+static inline bool isPlacementCellInShape(PlacementNode *node, int boardIndex) {
+    bool result = false;
+    for(int i = 0; i < node->count; ++i) {
+        if(node->cells[i] == boardIndex) {
+            result = true;
+            break;
+        }
+    }
+    return result;
+}
+
+static inline bool isPlacementExplosiveLeft(PlacementSearch *search, PlacementNode *node, int boardX, int boardY) {
+    BoardMasks *masks = &search->game->masks;
+    bool result = getMaskBit(masks, masks->explosiveRows, boardX, boardY);
+    int boardIndex = boardY*search->game->boardWidth + boardX;
+    for(int i = 0; i < node->destroyedCount && result; ++i) {
+        if(node->destroyed[i] == boardIndex) {
+            result = false;
+        }
+    }
+    return result;
+}
+
+//NOTE: The same as isDragTargetFree, but for the board as it is in this search state.
+static inline bool isPlacementDragTargetFree(PlacementSearch *search, PlacementNode *node, V2 pos) {
+    GameState *game = search->game;
+    int boardX = (int)pos.x;
+    int boardY = (int)pos.y;
+    bool result = (inBoardBounds(game, pos) && !getMaskBit(&game->masks, game->masks.staticRows, boardX, boardY) &&
+                   !isPlacementExplosiveLeft(search, node, boardX, boardY) &&
+                   !isPlacementCellInShape(node, getBoardIndex(game, pos)));
+    return result;
+}
+
+static inline V2 getPlacementCellPos(GameState *game, int boardIndex) {
+    V2 result = v2(boardIndex % game->boardWidth, boardIndex / game->boardWidth);
+    return result;
+}
+
+static void addPlacementNode(PlacementSearch *search, PlacementWorker *worker, PlacementNode *node) {
+    if(!insertPlacementKey(search, node->key)) {
+        worker->ttHits++;
+        return;
+    }
+    int nodeIndex = search->nodeCount.fetch_add(1, std::memory_order_relaxed);
+    if(nodeIndex >= search->settings.maxNodes) {
+        search->hitNodeLimit.store(true, std::memory_order_relaxed);
+        return;
+    }
+    search->nodes[nodeIndex] = *node;
+    worker->queue[worker->queueEnd++] = nodeIndex;
+}
+
+typedef enum {
+    PLACEMENT_MOVE_BLOCKED,
+    PLACEMENT_MOVE_OK,
+    PLACEMENT_MOVE_FAILS_LEVEL, //ran out of lives
+} PlacementMoveResult;
+
+//NOTE: The same rules as canShapeMove & moveShape. A block that moves onto an explosive is lost along with the explosive.
+static PlacementMoveResult movePlacementNode(PlacementSearch *search, PlacementNode *node, MoveType moveType, PlacementNode *child) {
+    GameState *game = search->game;
+    if(node->count == 0) {
+        return PLACEMENT_MOVE_BLOCKED;
+    }
+    V2 moveVec = getMoveVec(moveType);
+    for(int i = 0; i < node->count; ++i) {
+        V2 pos = v2_plus(getPlacementCellPos(game, node->cells[i]), moveVec);
+        if(!inBoardBounds(game, pos) || getMaskBit(&game->masks, game->masks.staticRows, (int)pos.x, (int)pos.y)) {
+            return PLACEMENT_MOVE_BLOCKED;
+        }
+    }
+
+    *child = *node;
+    child->count = 0;
+    int boardOffset = getBoardIndex(game, moveVec);
+    for(int i = 0; i < node->count; ++i) {
+        int oldIndex = node->cells[i];
+        int newIndex = oldIndex + boardOffset;
+        child->key ^= getZobristShapeKey(oldIndex);
+        V2 newPos = getPlacementCellPos(game, newIndex);
+        if(isPlacementExplosiveLeft(search, node, (int)newPos.x, (int)newPos.y)) {
+            child->destroyed[child->destroyedCount++] = newIndex;
+            child->key ^= getZobristStateKey(newIndex, BOARD_EXPLOSIVE);
+        } else {
+            child->cells[child->count++] = newIndex;
+            child->key ^= getZobristShapeKey(newIndex);
+        }
+    }
+    child->moveType = moveType;
+    child->moveFrom = child->moveTo = -1;
+
+    PlacementMoveResult result = (child->destroyedCount >= search->livesLeft) ? PLACEMENT_MOVE_FAILS_LEVEL : PLACEMENT_MOVE_OK;
+    return result;
+}
+
+static void expandPlacementNode(PlacementSearch *search, PlacementWorker *worker, int nodeIndex) {
+    GameState *game = search->game;
+    PlacementNode node = search->nodes[nodeIndex];
+    PlacementNode child;
+
+    PlacementMoveResult downResult = movePlacementNode(search, &node, MOVE_DOWN, &child);
+    if(downResult == PLACEMENT_MOVE_BLOCKED) {
+        int placementIndex = search->placementCount.fetch_add(1, std::memory_order_relaxed);
+        search->placementNodes[placementIndex] = nodeIndex;
+    } else if(downResult == PLACEMENT_MOVE_OK) {
+        child.parentIndex = nodeIndex;
+        addPlacementNode(search, worker, &child);
+    }
+
+    if(search->settings.allowSideMoves) {
+        MoveType sideMoves[] = {MOVE_LEFT, MOVE_RIGHT};
+        for(int moveIndex = 0; moveIndex < arrayCount(sideMoves); ++moveIndex) {
+            if(movePlacementNode(search, &node, sideMoves[moveIndex], &child) == PLACEMENT_MOVE_OK) {
+                child.parentIndex = nodeIndex;
+                addPlacementNode(search, worker, &child);
+            }
+        }
+    }
+
+    if(node.count > 1) {
+        HeldBlockGraph held;
+        ShapeGraph *graph = &held.graph;
+        graph->count = node.count;
+        for(int i = 0; i < node.count; ++i) {
+            graph->poses[i] = getPlacementCellPos(game, node.cells[i]);
+        }
+        buildShapeGraphNeighbours(graph);
+
+        for(int hotIndex = 0; hotIndex < node.count; ++hotIndex) {
+            if(!initHeldBlockFromGraph(&held, hotIndex)) {
+                continue;
+            }
+            uint32_t otherBlocks = held.mainIsland & ~((uint32_t)1 << hotIndex);
+            for(uint32_t bits = otherBlocks; bits; bits &= bits - 1) {
+                V2 blockPos = graph->poses[countTrailingZeros64(bits)];
+                for(int offsetIndex = 0; offsetIndex < arrayCount(shapeNeighbourOffsets); ++offsetIndex) {
+                    V2 pos = v2_plus(blockPos, shapeNeighbourOffsets[offsetIndex]);
+                    if(isPlacementDragTargetFree(search, &node, pos) && canMoveHeldBlock(&held, pos)) {
+                        int oldIndex = node.cells[hotIndex];
+                        int newIndex = getBoardIndex(game, pos);
+                        child = node;
+                        child.cells[hotIndex] = newIndex;
+                        child.key ^= getZobristShapeKey(oldIndex) ^ getZobristShapeKey(newIndex);
+                        child.parentIndex = nodeIndex;
+                        child.moveType = PLACEMENT_MOVE_DRAG;
+                        child.moveFrom = oldIndex;
+                        child.moveTo = newIndex;
+                        addPlacementNode(search, worker, &child);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void runPlacementWorker(PlacementSearch *search, int workerIndex) {
+    PlacementWorker *worker = &search->workers[workerIndex];
+    while(worker->queueStart < worker->queueEnd && !search->hitNodeLimit.load(std::memory_order_relaxed)) {
+        expandPlacementNode(search, worker, worker->queue[worker->queueStart++]);
+    }
+}
+
+//NOTE: Fills out the counts & score of a placement from the board it would leave. Lines are cleared the way
+//updateBoardWinState does it, only the blocks the player put down go and nothing above falls.
+void scorePlacement(PlacementSearch *search, PlacementNode *node, Placement *placement, uint64_t *rowBits, uint64_t *coveredBits, int *columnHeights) {
+    GameState *game = search->game;
+    BoardMasks *masks = &game->masks;
+
+    placement->count = node->count;
+    for(int i = 0; i < node->count; ++i) {
+        placement->coords[i] = getPlacementCellPos(game, node->cells[i]);
+    }
+    placement->explosivesHit = node->destroyedCount;
+
+    for(int wordIndex = 0; wordIndex < masks->wordsPerRow; ++wordIndex) {
+        coveredBits[wordIndex] = 0;
+    }
+    for(int boardX = 0; boardX < game->boardWidth; ++boardX) {
+        columnHeights[boardX] = 0;
+    }
+
+    for(int boardY = game->boardHeight - 1; boardY >= 0; --boardY) {
+        uint64_t *staticRow = getMaskRow(masks, masks->staticRows, boardY);
+        uint64_t *explosiveRow = getMaskRow(masks, masks->explosiveRows, boardY);
+        for(int wordIndex = 0; wordIndex < masks->wordsPerRow; ++wordIndex) {
+            rowBits[wordIndex] = staticRow[wordIndex] | explosiveRow[wordIndex];
+        }
+        for(int i = 0; i < node->destroyedCount; ++i) {
+            if(node->destroyed[i] / game->boardWidth == boardY) {
+                int boardX = node->destroyed[i] % game->boardWidth;
+                rowBits[boardX / BOARD_MASK_WORD_BITS] &= ~((uint64_t)1 << (boardX % BOARD_MASK_WORD_BITS));
+            }
+        }
+        for(int i = 0; i < node->count; ++i) {
+            if(node->cells[i] / game->boardWidth == boardY) {
+                int boardX = node->cells[i] % game->boardWidth;
+                rowBits[boardX / BOARD_MASK_WORD_BITS] |= (uint64_t)1 << (boardX % BOARD_MASK_WORD_BITS);
+            }
+        }
+
+        int filledCount = 0;
+        for(int wordIndex = 0; wordIndex < masks->wordsPerRow; ++wordIndex) {
+            filledCount += countSetBits64(rowBits[wordIndex]);
+        }
+        if(filledCount == game->boardWidth) {
+            placement->linesCleared++;
+            //NOTE: only the level's static blocks and the explosives stay
+            for(int wordIndex = 0; wordIndex < masks->wordsPerRow; ++wordIndex) {
+                uint64_t bits = rowBits[wordIndex] & ~explosiveRow[wordIndex];
+                while(bits) {
+                    int boardX = wordIndex*BOARD_MASK_WORD_BITS + countTrailingZeros64(bits);
+                    bits &= bits - 1;
+                    int boardIndex = boardY*game->boardWidth + boardX;
+                    if(isPlacementCellInShape(node, boardIndex) || game->board.types[boardIndex] == BOARD_VAL_OLD) {
+                        rowBits[wordIndex] &= ~((uint64_t)1 << (boardX % BOARD_MASK_WORD_BITS));
+                    }
+                }
+            }
+        }
+
+        for(int wordIndex = 0; wordIndex < masks->wordsPerRow; ++wordIndex) {
+            uint64_t bits = rowBits[wordIndex];
+            placement->holes += countSetBits64(coveredBits[wordIndex] & ~bits & masks->fullRow[wordIndex]);
+            uint64_t newlyCovered = bits & ~coveredBits[wordIndex];
+            while(newlyCovered) {
+                int boardX = wordIndex*BOARD_MASK_WORD_BITS + countTrailingZeros64(newlyCovered);
+                newlyCovered &= newlyCovered - 1;
+                columnHeights[boardX] = boardY + 1;
+            }
+            coveredBits[wordIndex] |= bits;
+            if(bits && placement->maxHeight == 0) {
+                placement->maxHeight = boardY + 1;
+            }
+        }
+
+        int spawnRowIndex = (game->boardHeight - 1) - boardY;
+        if(spawnRowIndex < game->shapes->spawnRowCount && (rowBits[0] & game->shapes->spawnRows[spawnRowIndex])) {
+            placement->blocksSpawn = true;
+        }
+    }
+
+    for(int boardX = 0; boardX < game->boardWidth - 1; ++boardX) {
+        placement->bumpiness += abs(columnHeights[boardX] - columnHeights[boardX + 1]);
+    }
+
+    placement->score = PLACEMENT_SCORE_LINE*sqr(placement->linesCleared) +
+                       PLACEMENT_SCORE_EXPLOSIVE*placement->explosivesHit +
+                       PLACEMENT_SCORE_HOLE*placement->holes +
+                       PLACEMENT_SCORE_HEIGHT*placement->maxHeight +
+                       PLACEMENT_SCORE_BUMPINESS*placement->bumpiness +
+                       (placement->blocksSpawn ? PLACEMENT_SCORE_BLOCKS_SPAWN : 0);
+}
+
+//NOTE: best score first. Ties go on the key so the order doesn't depend on which thread found what.
+int cmpPlacements(const void *a, const void *b) {
+    Placement *placementA = (Placement *)a;
+    Placement *placementB = (Placement *)b;
+    int result = placementB->score - placementA->score;
+    if(result == 0) {
+        result = (placementA->key < placementB->key) ? -1 : (placementA->key > placementB->key) ? 1 : 0;
+    }
+    return result;
+}
+
+/*
+    Everything the result points to is pushed on the arena, so take a memory mark around the search if you only need
+    it for a moment.
+*/
+PlacementSearchResult searchPlacements(GameState *game, FitrisShape *shape, PlacementSearchSettings settings, Arena *arena) {
+    assert(settings.maxNodes > 0);
+    PlacementSearch search = {};
+    search.game = game;
+    search.settings = settings;
+    search.livesLeft = game->lifePoints;
+
+    search.threadCount = settings.threadCount;
+    if(search.threadCount <= 0) {
+        search.threadCount = (int)std::thread::hardware_concurrency();
+    }
+    search.threadCount = (int)clamp(1, search.threadCount, MAX_PLACEMENT_THREADS);
+
+    //NOTE: every thread can put one key in past the node budget, keep the table under half full with that
+    uint32_t tableSize = 1;
+    while(tableSize < 2*(uint32_t)(settings.maxNodes + search.threadCount + 1)) {
+        tableSize <<= 1;
+    }
+    //NOTE: the arena doesn't align what it pushes. A compare and swap on a key split across two cache lines is a bus
+    //lock, which is really slow, so line the table up on 8 bytes.
+    uint8_t *tableMemory = pushArray(arena, (tableSize + 1)*sizeof(uint64_t), uint8_t);
+    search.tableKeys = (std::atomic<uint64_t> *)(((uintptr_t)tableMemory + 7) & ~(uintptr_t)7);
+    search.tableMask = tableSize - 1;
+
+    search.nodes = pushArray(arena, settings.maxNodes, PlacementNode);
+    search.placementNodes = pushArray(arena, settings.maxNodes, int);
+    search.workers = pushArray(arena, search.threadCount, PlacementWorker);
+    for(int workerIndex = 0; workerIndex < search.threadCount; ++workerIndex) {
+        search.workers[workerIndex].queue = pushArray(arena, settings.maxNodes, int);
+    }
+
+    PlacementNode root = {};
+    root.parentIndex = -1;
+    root.moveType = root.moveFrom = root.moveTo = -1;
+    for(int i = 0; i < shape->count; ++i) {
+        assert(getBoardState(game, shape->coords[i]) == BOARD_SHAPE);
+        root.cells[root.count] = getBoardIndex(game, shape->coords[i]);
+        root.key ^= getZobristShapeKey(root.cells[root.count]);
+        root.count++;
+    }
+
+    //NOTE: the root split. This thread expands the root into worker 0's queue, then the children get dealt out.
+    PlacementWorker *firstWorker = &search.workers[0];
+    addPlacementNode(&search, firstWorker, &root);
+    expandPlacementNode(&search, firstWorker, firstWorker->queue[firstWorker->queueStart++]);
+    if(search.threadCount > 1) {
+        int childCount = firstWorker->queueEnd - firstWorker->queueStart;
+        int *children = pushArray(arena, childCount + 1, int);
+        memcpy(children, firstWorker->queue + firstWorker->queueStart, sizeof(int)*childCount);
+        firstWorker->queueStart = firstWorker->queueEnd = 0;
+        for(int childIndex = 0; childIndex < childCount; ++childIndex) {
+            PlacementWorker *worker = &search.workers[childIndex % search.threadCount];
+            worker->queue[worker->queueEnd++] = children[childIndex];
+        }
+    }
+
+    //NOTE: this thread is worker 0
+    std::thread threads[MAX_PLACEMENT_THREADS];
+    for(int workerIndex = 1; workerIndex < search.threadCount; ++workerIndex) {
+        if(search.workers[workerIndex].queueEnd > 0) {
+            threads[workerIndex] = std::thread(runPlacementWorker, &search, workerIndex);
+        }
+    }
+    runPlacementWorker(&search, 0);
+    for(int workerIndex = 1; workerIndex < search.threadCount; ++workerIndex) {
+        if(threads[workerIndex].joinable()) {
+            threads[workerIndex].join();
+        }
+    }
+
+    PlacementSearchResult result = {};
+    result.nodes = search.nodes;
+    result.nodeCount = search.nodeCount.load();
+    if(result.nodeCount > settings.maxNodes) {
+        result.nodeCount = settings.maxNodes;
+    }
+    result.hitNodeLimit = search.hitNodeLimit.load();
+    for(int workerIndex = 0; workerIndex < search.threadCount; ++workerIndex) {
+        result.ttHits += search.workers[workerIndex].ttHits;
+    }
+
+    result.placementCount = search.placementCount.load();
+    result.placements = pushArray(arena, result.placementCount, Placement);
+    uint64_t *rowBits = pushArray(arena, game->masks.wordsPerRow, uint64_t);
+    uint64_t *coveredBits = pushArray(arena, game->masks.wordsPerRow, uint64_t);
+    int *columnHeights = pushArray(arena, game->boardWidth, int);
+    for(int placementIndex = 0; placementIndex < result.placementCount; ++placementIndex) {
+        Placement *placement = &result.placements[placementIndex];
+        placement->nodeIndex = search.placementNodes[placementIndex];
+        placement->key = search.nodes[placement->nodeIndex].key;
+        scorePlacement(&search, &search.nodes[placement->nodeIndex], placement, rowBits, coveredBits, columnHeights);
+    }
+    qsort(result.placements, result.placementCount, sizeof(Placement), cmpPlacements);
+
+    return result;
+}
+
+//NOTE: The moves from the shape where it was to the placement, pushed on the arena.
+PlacementMove *getPlacementPath(PlacementSearchResult *result, GameState *game, int placementIndex, Arena *arena, int *moveCount) {
+    assert(placementIndex >= 0 && placementIndex < result->placementCount);
+    int count = 0;
+    for(int nodeIndex = result->placements[placementIndex].nodeIndex; result->nodes[nodeIndex].parentIndex >= 0;
+        nodeIndex = result->nodes[nodeIndex].parentIndex) {
+        count++;
+    }
+
+    PlacementMove *moves = pushArray(arena, count + 1, PlacementMove);
+    int moveIndex = count;
+    for(int nodeIndex = result->placements[placementIndex].nodeIndex; result->nodes[nodeIndex].parentIndex >= 0;
+        nodeIndex = result->nodes[nodeIndex].parentIndex) {
+        PlacementNode *node = &result->nodes[nodeIndex];
+        PlacementMove *move = &moves[--moveIndex];
+        move->moveType = node->moveType;
+        if(node->moveType == PLACEMENT_MOVE_DRAG) {
+            move->from = getPlacementCellPos(game, node->moveFrom);
+            move->to = getPlacementCellPos(game, node->moveTo);
+        }
+    }
+    assert(moveIndex == 0);
+    *moveCount = count;
+    return moves;
+}
+
+//NOTE: Does one move of a path to the shape in the game, the way updateShape would. Returns false if the game doesn't allow it.
+bool applyPlacementMove(GameState *game, FitrisShape *shape, PlacementMove *move) {
+    bool result = false;
+    if(move->moveType == PLACEMENT_MOVE_DRAG) {
+        int hotIndex = -1;
+        for(int i = 0; i < shape->count; ++i) {
+            if(shape->coords[i].x == move->from.x && shape->coords[i].y == move->from.y) {
+                hotIndex = i;
+                break;
+            }
+        }
+        if(hotIndex >= 0 && shapeStillConnected(shape, hotIndex, move->to, game)) {
+            setBoardState(game, move->from, BOARD_NULL, BOARD_VAL_TRANSIENT);
+            setBoardState(game, move->to, BOARD_SHAPE, BOARD_VAL_TRANSIENT);
+            shape->coords[hotIndex] = move->to;
+            shape->mask = 0;
+            result = true;
+        }
+    } else {
+        result = moveShape(shape, game, (MoveType)move->moveType);
+        game->wasHitByExplosive = false;
+    }
+    return result;
+}
@@ -0,0 +1,335 @@
+/*
+    Records the inputs stepGame consumes so a session can be played back offline, headless and as fast as it will go.
+
+    File layout: a ReplayHeader, then a stream of records, each starting with a one byte tag.
+
+    REPLAY_RECORD_FRAME    one stepGame call. The tag's high bits say what changed since the last frame:
+                               REPLAY_FRAME_BUTTONS  varint count, then count x (u8 button, u8 isDown | transitionCount << 1)
+                               REPLAY_FRAME_MOUSE    zigzag varint dx, dy of the mouse board cell
+                               REPLAY_FRAME_DT       the 4 bytes of the float dt
+    REPLAY_RECORD_REPEAT   varint count, that many more frames the same as the last one
+    REPLAY_RECORD_RESTART  varint levelType, varint blockCount. A restartLevel call.
+    REPLAY_RECORD_END      varint frameCount, u64 getGameHash, zigzag varint experiencePoints, lifePoints
+
+    The mouse is stored as the board cell it is over (rounded, not clamped), the sim only uses the cell it is over.
+*/
+
+#define REPLAY_MAGIC 0x50525446 //'FTRP'
+#define REPLAY_VERSION 4 //2 added levelFileHash, 3 steps the windmills on the timer wheel's ticks, 4 added shapeCatalogueHash
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int32_t boardWidth;
+    int32_t boardHeight;
+    int32_t levelType;
+    int32_t blockCount;
+    RandomSeries random; //what GameState.random was before initGame
+    uint64_t levelFileHash; //LevelFile.hash of the levels the game used, 0 if it made random ones
+    uint64_t shapeCatalogueHash; //ShapeCatalogue.hash of the shapes the game spawned
+} ReplayHeader;
+
+typedef enum {
+    REPLAY_RECORD_NULL,
+    REPLAY_RECORD_FRAME,
+    REPLAY_RECORD_REPEAT,
+    REPLAY_RECORD_RESTART,
+    REPLAY_RECORD_END,
+} ReplayRecordType;
+
+#define REPLAY_RECORD_TYPE_MASK 0x7
+#define REPLAY_FRAME_BUTTONS (1 << 3)
+#define REPLAY_FRAME_MOUSE (1 << 4)
+#define REPLAY_FRAME_DT (1 << 5)
+
+static inline uint32_t zigZagEncode(int32_t value) {
+    uint32_t result = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    return result;
+}
+
+static inline int32_t zigZagDecode(uint32_t value) {
+    int32_t result = (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+    return result;
+}
+
+///////////////////////************ Writing *************////////////////////
+
+typedef struct {
+    FILE *file; //null when we aren't recording
+    int frameCount;
+    int repeatCount; //frames the same as lastInput that haven't been written yet
+
+    GameInput lastInput;
+    float lastDt;
+} ReplayRecorder;
+
+static inline void writeReplayByte(ReplayRecorder *recorder, uint8_t value) {
+    fputc(value, recorder->file);
+}
+
+static inline void writeReplayVarint(ReplayRecorder *recorder, uint64_t value) {
+    while(value >= 0x80) {
+        writeReplayByte(recorder, (uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    writeReplayByte(recorder, (uint8_t)value);
+}
+
+static inline void flushReplayRepeats(ReplayRecorder *recorder) {
+    if(recorder->repeatCount > 0) {
+        writeReplayByte(recorder, REPLAY_RECORD_REPEAT);
+        writeReplayVarint(recorder, recorder->repeatCount);
+        recorder->repeatCount = 0;
+    }
+}
+
+//NOTE: Call before initGame, with the same values. Returns false if the file couldn't be opened, the recorder then does nothing.
+bool beginReplayRecording(ReplayRecorder *recorder, char *fileName, int boardWidth, int boardHeight, LevelType levelType, int blockCount, RandomSeries random, uint64_t levelFileHash, uint64_t shapeCatalogueHash) {
+    zeroStruct(recorder, ReplayRecorder);
+    recorder->file = fopen(fileName, "wb");
+    if(recorder->file) {
+        ReplayHeader header = {};
+        header.magic = REPLAY_MAGIC;
+        header.version = REPLAY_VERSION;
+        header.boardWidth = boardWidth;
+        header.boardHeight = boardHeight;
+        header.levelType = levelType;
+        header.blockCount = blockCount;
+        header.random = random;
+        header.levelFileHash = levelFileHash;
+        header.shapeCatalogueHash = shapeCatalogueHash;
+        fwrite(&header, sizeof(header), 1, recorder->file);
+    }
+    return (recorder->file != 0);
+}
+
+void recordReplayFrame(ReplayRecorder *recorder, GameInput *input, float dt) {
+    if(!recorder->file) {
+        return;
+    }
+    uint8_t tag = REPLAY_RECORD_FRAME;
+
+    int changedButtons = 0;
+    for(int buttonIndex = 0; buttonIndex < BUTTON_COUNT; ++buttonIndex) {
+        GameButton *button = input->buttons + buttonIndex;
+        GameButton *lastButton = recorder->lastInput.buttons + buttonIndex;
+        if(button->isDown != lastButton->isDown || button->transitionCount != lastButton->transitionCount) {
+            changedButtons++;
+        }
+    }
+    if(changedButtons) { tag |= REPLAY_FRAME_BUTTONS; }
+
+    V2 mouseCell = input->mouseBoardP;
+    V2 lastMouseCell = recorder->lastInput.mouseBoardP;
+    assert(mouseCell.x == floorf(mouseCell.x) && mouseCell.y == floorf(mouseCell.y)); //see getMouseBoardCell
+    if(mouseCell.x != lastMouseCell.x || mouseCell.y != lastMouseCell.y) { tag |= REPLAY_FRAME_MOUSE; }
+    if(dt != recorder->lastDt) { tag |= REPLAY_FRAME_DT; }
+
+    if(tag == REPLAY_RECORD_FRAME && recorder->frameCount > 0) {
+        recorder->repeatCount++;
+    } else {
+        flushReplayRepeats(recorder);
+        writeReplayByte(recorder, tag);
+        if(tag & REPLAY_FRAME_BUTTONS) {
+            writeReplayVarint(recorder, changedButtons);
+            for(int buttonIndex = 0; buttonIndex < BUTTON_COUNT; ++buttonIndex) {
+                GameButton *button = input->buttons + buttonIndex;
+                GameButton *lastButton = recorder->lastInput.buttons + buttonIndex;
+                if(button->isDown != lastButton->isDown || button->transitionCount != lastButton->transitionCount) {
+                    assert(button->transitionCount >= 0 && button->transitionCount < 128);
+                    writeReplayByte(recorder, (uint8_t)buttonIndex);
+                    writeReplayByte(recorder, (uint8_t)((button->isDown ? 1 : 0) | (button->transitionCount << 1)));
+                }
+            }
+        }
+        if(tag & REPLAY_FRAME_MOUSE) {
+            writeReplayVarint(recorder, zigZagEncode((int32_t)(mouseCell.x - lastMouseCell.x)));
+            writeReplayVarint(recorder, zigZagEncode((int32_t)(mouseCell.y - lastMouseCell.y)));
+        }
+        if(tag & REPLAY_FRAME_DT) {
+            fwrite(&dt, sizeof(dt), 1, recorder->file);
+        }
+    }
+
+    recorder->lastInput = *input;
+    recorder->lastDt = dt;
+    recorder->frameCount++;
+}
+
+void recordReplayRestart(ReplayRecorder *recorder, LevelType levelType, int blockCount) {
+    if(!recorder->file) {
+        return;
+    }
+    flushReplayRepeats(recorder);
+    writeReplayByte(recorder, REPLAY_RECORD_RESTART);
+    writeReplayVarint(recorder, levelType);
+    writeReplayVarint(recorder, blockCount);
+    //NOTE: a good point to get what we have onto disk in case the app gets killed
+    fflush(recorder->file);
+}
+
+void endReplayRecording(ReplayRecorder *recorder, GameState *game) {
+    if(!recorder->file) {
+        return;
+    }
+    flushReplayRepeats(recorder);
+    writeReplayByte(recorder, REPLAY_RECORD_END);
+    writeReplayVarint(recorder, recorder->frameCount);
+    uint64_t hash = getGameHash(game);
+    fwrite(&hash, sizeof(hash), 1, recorder->file);
+    writeReplayVarint(recorder, zigZagEncode(game->experiencePoints));
+    writeReplayVarint(recorder, zigZagEncode(game->lifePoints));
+    fclose(recorder->file);
+    recorder->file = 0;
+}
+
+///////////////////////************ Reading *************////////////////////
+
+typedef struct {
+    bool valid;
+    ReplayHeader header;
+
+    uint8_t *at;
+    uint8_t *end;
+
+    //NOTE: the frame we are building up from the deltas
+    GameInput input;
+    float dt;
+    int repeatsLeft;
+} ReplayReader;
+
+typedef struct {
+    ReplayRecordType type;
+
+    //REPLAY_RECORD_RESTART
+    LevelType levelType;
+    int blockCount;
+
+    //REPLAY_RECORD_END
+    int frameCount;
+    uint64_t hash;
+    int experiencePoints;
+    int lifePoints;
+} ReplayRecord;
+
+static inline uint8_t readReplayByte(ReplayReader *reader) {
+    uint8_t result = 0;
+    if(reader->at < reader->end) {
+        result = *reader->at++;
+    } else {
+        reader->valid = false;
+    }
+    return result;
+}
+
+static inline uint64_t readReplayVarint(ReplayReader *reader) {
+    uint64_t result = 0;
+    int shift = 0;
+    uint8_t byte = 0;
+    do {
+        byte = readReplayByte(reader);
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while((byte & 0x80) && reader->valid && shift < 64);
+    return result;
+}
+
+static inline void readReplayBytes(ReplayReader *reader, void *dest, size_t size) {
+    if((size_t)(reader->end - reader->at) >= size) {
+        memcpy(dest, reader->at, size);
+        reader->at += size;
+    } else {
+        reader->valid = false;
+    }
+}
+
+//NOTE: Reads the whole file into the arena.
+ReplayReader beginReplayReading(Arena *arena, char *fileName) {
+    ReplayReader reader = {};
+    FILE *file = fopen(fileName, "rb");
+    if(file) {
+        fseek(file, 0, SEEK_END);
+        long fileSize = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        if(fileSize >= (long)sizeof(ReplayHeader)) {
+            uint8_t *memory = pushArray(arena, fileSize, uint8_t);
+            if(fread(memory, fileSize, 1, file) == 1) {
+                reader.at = memory;
+                reader.end = memory + fileSize;
+                reader.valid = true;
+                readReplayBytes(&reader, &reader.header, sizeof(reader.header));
+                if(reader.header.magic != REPLAY_MAGIC || reader.header.version != REPLAY_VERSION) {
+                    reader.valid = false;
+                }
+            }
+        }
+        fclose(file);
+    }
+    return reader;
+}
+
+//NOTE: For a REPLAY_RECORD_FRAME the input & dt to step with are in reader->input & reader->dt.
+ReplayRecord readReplayRecord(ReplayReader *reader) {
+    ReplayRecord record = {};
+    if(reader->repeatsLeft > 0) {
+        reader->repeatsLeft--;
+        record.type = REPLAY_RECORD_FRAME;
+        return record;
+    }
+
+    uint8_t tag = readReplayByte(reader);
+    if(!reader->valid) {
+        return record;
+    }
+    record.type = (ReplayRecordType)(tag & REPLAY_RECORD_TYPE_MASK);
+    switch(record.type) {
+        case REPLAY_RECORD_FRAME: {
+            if(tag & REPLAY_FRAME_BUTTONS) {
+                int changedButtons = (int)readReplayVarint(reader);
+                for(int changeIndex = 0; changeIndex < changedButtons && reader->valid; ++changeIndex) {
+                    int buttonIndex = readReplayByte(reader);
+                    uint8_t value = readReplayByte(reader);
+                    if(buttonIndex < BUTTON_COUNT) {
+                        reader->input.buttons[buttonIndex].isDown = (value & 1);
+                        reader->input.buttons[buttonIndex].transitionCount = (value >> 1);
+                    } else {
+                        reader->valid = false;
+                    }
+                }
+            }
+            if(tag & REPLAY_FRAME_MOUSE) {
+                reader->input.mouseBoardP.x += zigZagDecode((uint32_t)readReplayVarint(reader));
+                reader->input.mouseBoardP.y += zigZagDecode((uint32_t)readReplayVarint(reader));
+            }
+            if(tag & REPLAY_FRAME_DT) {
+                readReplayBytes(reader, &reader->dt, sizeof(reader->dt));
+            }
+        } break;
+        case REPLAY_RECORD_REPEAT: {
+            int repeatCount = (int)readReplayVarint(reader);
+            if(repeatCount > 0) {
+                reader->repeatsLeft = repeatCount - 1;
+                record.type = REPLAY_RECORD_FRAME;
+            } else {
+                reader->valid = false;
+            }
+        } break;
+        case REPLAY_RECORD_RESTART: {
+            record.levelType = (LevelType)readReplayVarint(reader);
+            record.blockCount = (int)readReplayVarint(reader);
+        } break;
+        case REPLAY_RECORD_END: {
+            record.frameCount = (int)readReplayVarint(reader);
+            readReplayBytes(reader, &record.hash, sizeof(record.hash));
+            record.experiencePoints = zigZagDecode((uint32_t)readReplayVarint(reader));
+            record.lifePoints = zigZagDecode((uint32_t)readReplayVarint(reader));
+        } break;
+        default: {
+            reader->valid = false;
+        }
+    }
+    if(!reader->valid) {
+        record.type = REPLAY_RECORD_NULL;
+    }
+    return record;
+}
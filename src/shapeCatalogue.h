@@ -0,0 +1,334 @@
+/*
+    The shapes a new shape can be. Each one is stored as a ShapeMask per rotation: a row of bits per board row, bottom
+    row first, bit x is column x, moved down & left so it touches row 0 and column 0. With the masks a spawn, a
+    rotation or a collision test is an and of a few rows against the BoardMasks instead of a look at every cell.
+
+    The built in catalogue is worked out by the compiler (constexpr, needs C++14), so the game starts with every
+    rotation ready. A shape file (res/shapes.txt) can replace it at start up, the shapes in it go through the same
+    functions when it's loaded. Each line of the file is
+        shape: "name" spawnWeight "row" "row" ...;
+    with the rows top to bottom, '#' a block and '.' a gap. A spawnWeight of 0 keeps the shape out of the game.
+
+    The built in catalogue only spawns the 4 block line, the same as the game always has, so recordings and the
+    level file still play the same.
+*/
+
+#define SHAPE_GRID_SIZE MAX_SHAPE_COUNT //a shape can't be wider or taller than it has blocks
+#define SHAPE_ROTATION_COUNT 4
+#define MAX_CATALOGUE_SHAPES 64
+#define SHAPE_NAME_LENGTH 32
+
+typedef struct {
+    uint16_t rows[SHAPE_GRID_SIZE];
+    int width; //0 if the shape didn't parse
+    int height;
+} ShapeMask;
+
+typedef struct {
+    char name[SHAPE_NAME_LENGTH];
+    int blockCount;
+    int spawnWeight; //0 never spawns
+    int rotationCount; //how many of the rotations are different: 1, 2 or 4
+    ShapeMask rotations[SHAPE_ROTATION_COUNT]; //each a quarter turn clockwise from the one before
+} CatalogueShape;
+
+typedef struct {
+    int shapeCount;
+    int totalSpawnWeight;
+    int spawnShapeCount; //how many shapes have a spawnWeight. With one there's no random number to pick.
+    int firstSpawnShape;
+
+    //NOTE: every cell any shape can spawn on, top row first, bit x is column x. The placement search uses it to know
+    //if a placement stops the next shape.
+    uint16_t spawnRows[SHAPE_GRID_SIZE];
+    int spawnRowCount;
+
+    uint64_t hash; //FNV-1a of the shapes that can spawn & their weights, replays keep it so they know they spawn the same shapes
+    CatalogueShape shapes[MAX_CATALOGUE_SHAPES];
+} ShapeCatalogue;
+
+typedef struct {
+    const char *name;
+    int spawnWeight;
+    const char *rows; //top to bottom, split by '|'
+} ShapeDef;
+
+///////////////////////************ Building masks *************////////////////////
+
+constexpr bool shapeMasksMatch(const ShapeMask &a, const ShapeMask &b) {
+    bool result = (a.width == b.width && a.height == b.height);
+    for(int y = 0; y < SHAPE_GRID_SIZE && result; ++y) {
+        result = (a.rows[y] == b.rows[y]);
+    }
+    return result;
+}
+
+//NOTE: Moves the blocks down & left until they touch row 0 & column 0, and works out the width & height.
+constexpr ShapeMask normalizeShapeMask(const ShapeMask &mask) {
+    ShapeMask result = {};
+    int minX = SHAPE_GRID_SIZE;
+    int minY = SHAPE_GRID_SIZE;
+    int maxX = -1;
+    int maxY = -1;
+    for(int y = 0; y < SHAPE_GRID_SIZE; ++y) {
+        for(int x = 0; x < SHAPE_GRID_SIZE; ++x) {
+            if((mask.rows[y] >> x) & 1) {
+                if(x < minX) { minX = x; }
+                if(x > maxX) { maxX = x; }
+                if(y < minY) { minY = y; }
+                if(y > maxY) { maxY = y; }
+            }
+        }
+    }
+    if(maxX >= 0) {
+        for(int y = minY; y <= maxY; ++y) {
+            result.rows[y - minY] = (uint16_t)(mask.rows[y] >> minX);
+        }
+        result.width = maxX - minX + 1;
+        result.height = maxY - minY + 1;
+    }
+    return result;
+}
+
+//NOTE: rows is top to bottom split by '|', '#' or 'X' is a block. Returns a width of 0 if it doesn't fit.
+constexpr ShapeMask parseShapeMask(const char *rows) {
+    ShapeMask result = {};
+    int rowCount = 1;
+    for(const char *at = rows; *at; ++at) {
+        rowCount += (*at == '|');
+    }
+    bool valid = (rowCount <= SHAPE_GRID_SIZE);
+    int y = rowCount - 1;
+    int x = 0;
+    for(const char *at = rows; *at && valid; ++at) {
+        if(*at == '|') {
+            y--;
+            x = 0;
+        } else {
+            if(x >= SHAPE_GRID_SIZE) {
+                valid = false;
+            } else if(*at == '#' || *at == 'X') {
+                result.rows[y] |= (uint16_t)(1 << x);
+            }
+            x++;
+        }
+    }
+    if(valid) {
+        result = normalizeShapeMask(result);
+    } else {
+        result = ShapeMask{};
+    }
+    return result;
+}
+
+//NOTE: A quarter turn clockwise: (x, y) goes to (y, width - 1 - x).
+constexpr ShapeMask rotateShapeMask(const ShapeMask &mask) {
+    ShapeMask result = {};
+    for(int y = 0; y < mask.height; ++y) {
+        for(int x = 0; x < mask.width; ++x) {
+            if((mask.rows[y] >> x) & 1) {
+                result.rows[mask.width - 1 - x] |= (uint16_t)(1 << y);
+            }
+        }
+    }
+    result.width = mask.height;
+    result.height = mask.width;
+    return result;
+}
+
+constexpr int countShapeMaskBlocks(const ShapeMask &mask) {
+    int result = 0;
+    for(int y = 0; y < mask.height; ++y) {
+        for(int x = 0; x < mask.width; ++x) {
+            result += (mask.rows[y] >> x) & 1;
+        }
+    }
+    return result;
+}
+
+constexpr CatalogueShape makeCatalogueShape(const char *name, int spawnWeight, const char *rows) {
+    CatalogueShape result = {};
+    for(int i = 0; i < SHAPE_NAME_LENGTH - 1 && name[i]; ++i) {
+        result.name[i] = name[i];
+    }
+    result.spawnWeight = spawnWeight;
+    result.rotations[0] = parseShapeMask(rows);
+    for(int rotation = 1; rotation < SHAPE_ROTATION_COUNT; ++rotation) {
+        result.rotations[rotation] = rotateShapeMask(result.rotations[rotation - 1]);
+    }
+    result.blockCount = countShapeMaskBlocks(result.rotations[0]);
+    if(shapeMasksMatch(result.rotations[1], result.rotations[0])) {
+        result.rotationCount = 1;
+    } else if(shapeMasksMatch(result.rotations[2], result.rotations[0])) {
+        result.rotationCount = 2;
+    } else {
+        result.rotationCount = SHAPE_ROTATION_COUNT;
+    }
+    return result;
+}
+
+constexpr uint64_t hashShapeCatalogueValue(uint64_t hash, uint64_t value) {
+    for(int byteIndex = 0; byteIndex < 8; ++byteIndex) {
+        hash = (hash ^ ((value >> (8*byteIndex)) & 0xff))*1099511628211ULL;
+    }
+    return hash;
+}
+
+//NOTE: Works out the spawn totals, spawnRows & the hash once the shapes are in.
+constexpr void finishShapeCatalogue(ShapeCatalogue *catalogue) {
+    catalogue->totalSpawnWeight = 0;
+    catalogue->spawnShapeCount = 0;
+    catalogue->firstSpawnShape = -1;
+    catalogue->spawnRowCount = 0;
+    for(int y = 0; y < SHAPE_GRID_SIZE; ++y) {
+        catalogue->spawnRows[y] = 0;
+    }
+    uint64_t hash = 14695981039346656037ULL;
+    for(int shapeIndex = 0; shapeIndex < catalogue->shapeCount; ++shapeIndex) {
+        const CatalogueShape *shape = &catalogue->shapes[shapeIndex];
+        const ShapeMask *mask = &shape->rotations[0];
+        if(shape->spawnWeight > 0) {
+            hash = hashShapeCatalogueValue(hash, (uint64_t)shape->spawnWeight);
+            hash = hashShapeCatalogueValue(hash, (uint64_t)mask->width << 32 | (uint64_t)mask->height);
+            for(int y = 0; y < mask->height; ++y) {
+                hash = hashShapeCatalogueValue(hash, mask->rows[y]);
+            }
+            if(catalogue->firstSpawnShape < 0) {
+                catalogue->firstSpawnShape = shapeIndex;
+            }
+            catalogue->spawnShapeCount++;
+            catalogue->totalSpawnWeight += shape->spawnWeight;
+            for(int y = 0; y < mask->height; ++y) {
+                catalogue->spawnRows[y] |= mask->rows[mask->height - 1 - y];
+            }
+            if(mask->height > catalogue->spawnRowCount) {
+                catalogue->spawnRowCount = mask->height;
+            }
+        }
+    }
+    catalogue->hash = hash;
+}
+
+constexpr ShapeCatalogue buildShapeCatalogue(const ShapeDef *defs, int defCount) {
+    ShapeCatalogue result = {};
+    for(int defIndex = 0; defIndex < defCount && defIndex < MAX_CATALOGUE_SHAPES; ++defIndex) {
+        result.shapes[result.shapeCount++] = makeCatalogueShape(defs[defIndex].name, defs[defIndex].spawnWeight, defs[defIndex].rows);
+    }
+    finishShapeCatalogue(&result);
+    return result;
+}
+
+///////////////////////************ The built in shapes *************////////////////////
+
+static constexpr ShapeDef defaultShapeDefs[] = {
+    {"I", 1, "####"},
+    {"O", 0, "##|##"},
+    {"T", 0, "###|.#."},
+    {"S", 0, ".##|##."},
+    {"Z", 0, "##.|.##"},
+    {"J", 0, "#..|###"},
+    {"L", 0, "..#|###"},
+};
+
+static constexpr ShapeCatalogue defaultShapeCatalogue = buildShapeCatalogue(defaultShapeDefs, arrayCount(defaultShapeDefs));
+
+static_assert(defaultShapeCatalogue.shapeCount == 7 && defaultShapeCatalogue.spawnShapeCount == 1, "only the line spawns");
+static_assert(defaultShapeCatalogue.shapes[0].rotations[0].rows[0] == 0xf && defaultShapeCatalogue.shapes[0].rotationCount == 2, "I");
+static_assert(defaultShapeCatalogue.shapes[0].rotations[1].width == 1 && defaultShapeCatalogue.shapes[0].rotations[1].height == 4, "I turned");
+static_assert(defaultShapeCatalogue.shapes[1].rotationCount == 1 && defaultShapeCatalogue.shapes[2].rotationCount == 4, "O & T");
+static_assert(defaultShapeCatalogue.shapes[2].rotations[0].rows[0] == 0x2 && defaultShapeCatalogue.shapes[2].rotations[0].rows[1] == 0x7, "T");
+
+///////////////////////************ Loading *************////////////////////
+
+//NOTE: Replaces the catalogue with the shapes in the file. Leaves it alone & returns false if the file can't be read
+//or nothing in it can spawn.
+bool loadShapeCatalogue(char *fileName, ShapeCatalogue *catalogue) {
+    bool result = false;
+    char *contents = 0;
+    FILE *file = fopen(fileName, "rb");
+    if(file) {
+        fseek(file, 0, SEEK_END);
+        long fileSize = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        contents = (char *)calloc(fileSize + 1, 1);
+        if(fread(contents, 1, fileSize, file) != (size_t)fileSize) {
+            free(contents);
+            contents = 0;
+        }
+        fclose(file);
+    }
+
+    if(contents) {
+        ShapeCatalogue *loaded = (ShapeCatalogue *)calloc(1, sizeof(ShapeCatalogue));
+        EasyTokenizer tokenizer = lexBeginParsing(contents, true);
+        bool parsing = true;
+        while(parsing) {
+            EasyToken token = lexGetNextToken(&tokenizer);
+            switch(token.type) {
+                case TOKEN_NULL_TERMINATOR: {
+                    parsing = false;
+                } break;
+                case TOKEN_WORD: {
+                    InfiniteAlloc data = getDataObjects(&tokenizer);
+                    DataObject *objs = (DataObject *)data.memory;
+                    bool isShape = (stringsMatchNullN("shape", token.at, token.size) && data.count >= 3 &&
+                                    objs[0].type == VAR_CHAR_STAR && objs[1].type == VAR_INT);
+                    if(isShape && loaded->shapeCount < MAX_CATALOGUE_SHAPES) {
+                        //NOTE: join the rows up the way parseShapeMask wants them
+                        char rows[SHAPE_GRID_SIZE*(SHAPE_GRID_SIZE + 1) + 1] = {};
+                        int rowsAt = 0;
+                        bool fits = true;
+                        for(int objIndex = 2; objIndex < data.count && fits; ++objIndex) {
+                            char *row = objs[objIndex].stringVal;
+                            int rowLength = (int)strlen(row);
+                            fits = (objs[objIndex].type == VAR_CHAR_STAR && rowLength <= SHAPE_GRID_SIZE &&
+                                    rowsAt + rowLength + 1 < (int)sizeof(rows));
+                            if(fits) {
+                                if(objIndex > 2) {
+                                    rows[rowsAt++] = '|';
+                                }
+                                memcpy(rows + rowsAt, row, rowLength);
+                                rowsAt += rowLength;
+                            }
+                        }
+                        CatalogueShape shape = makeCatalogueShape(objs[0].stringVal, (int)objs[1].intVal, rows);
+                        if(fits && shape.blockCount > 0 && shape.blockCount <= MAX_SHAPE_COUNT) {
+                            loaded->shapes[loaded->shapeCount++] = shape;
+                        } else {
+                            printf("shape %s in %s doesn't fit, left out\n", objs[0].stringVal, fileName);
+                        }
+                    }
+                    releaseInfiniteAlloc(&data);
+                } break;
+                default: {
+
+                }
+            }
+        }
+        finishShapeCatalogue(loaded);
+        if(loaded->spawnShapeCount > 0) {
+            *catalogue = *loaded;
+            result = true;
+        }
+        free(loaded);
+        free(contents);
+    }
+    return result;
+}
+
+//NOTE: Picks the shape to spawn. Only takes a random number when more than one shape can spawn.
+int pickSpawnShape(const ShapeCatalogue *catalogue, RandomSeries *random) {
+    assert(catalogue->spawnShapeCount > 0);
+    int result = catalogue->firstSpawnShape;
+    if(catalogue->spawnShapeCount > 1) {
+        int weightAt = (int)randomIndex(random, catalogue->totalSpawnWeight);
+        for(int shapeIndex = 0; shapeIndex < catalogue->shapeCount; ++shapeIndex) {
+            weightAt -= catalogue->shapes[shapeIndex].spawnWeight;
+            if(weightAt < 0) {
+                result = shapeIndex;
+                break;
+            }
+        }
+    }
+    return result;
+}
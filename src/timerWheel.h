@@ -0,0 +1,264 @@
+/*
+    A hierarchical timer wheel for the board events that happen at a set time, like a windmill taking a step. Time is
+    counted in ticks of 1/TIMER_WHEEL_TICKS_PER_SECOND seconds. An event waits in a slot of the level that covers how
+    far off it is: level 0 has a slot a tick for the rest of the current 64 ticks, level 1 a slot per 64 ticks for the
+    rest of the current 64*64 ticks and so on. When a level comes round to its next slot, the events in it move down
+    to the levels below. So advancing costs the ticks gone by plus the events that fire, never the events that are
+    still waiting. When level 0 is empty we skip straight to it coming round again.
+
+    Events further off than the top level wait on the overflow list, which is looked at every time the top level
+    comes round.
+
+    Events are indexes into a pool, so copying the wheel is a memcpy. The pool doubles from the arena when it fills,
+    the old one is left behind on the arena.
+*/
+
+#define TIMER_WHEEL_TICKS_PER_SECOND 240
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOT_COUNT (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_LEVEL_COUNT 4 //2^24 ticks, about 19 hours
+#define TIMER_WHEEL_OVERFLOW_SLOT (TIMER_WHEEL_LEVEL_COUNT*TIMER_WHEEL_SLOT_COUNT)
+#define TIMER_WHEEL_START_CAPACITY 16
+
+typedef enum {
+    TIMER_EVENT_NULL,
+    TIMER_EVENT_EXTRA_SHAPE, //data is the index into GameState.extraShapes
+} TimerEventType;
+
+typedef struct {
+    uint64_t fireTick;
+    TimerEventType type;
+    int data; //what the event is for, see TimerEventType
+
+    int slot; //-1 when the event is free
+    int next;
+    int prev;
+} TimerEvent;
+
+typedef struct {
+    Arena *arena;
+
+    uint64_t currentTick;
+    float tickRemainder; //the part of a tick the dt's have added up to that isn't a whole tick yet
+
+    int eventCount;
+    int eventCapacity;
+    TimerEvent *events;
+    int firstFreeEvent;
+
+    int slotHeads[TIMER_WHEEL_OVERFLOW_SLOT + 1];
+    uint64_t occupied[TIMER_WHEEL_LEVEL_COUNT]; //bit s is set when slot s of the level has events in it
+
+    //NOTE: the events the last advance fired, by fire tick. Ones due on the same tick come out in an order that only
+    //depends on when they were scheduled, so it is the same every time a replay runs. They are already freed.
+    int firedCount;
+    int firedCapacity;
+    TimerEvent *fired;
+} TimerWheel;
+
+static void growTimerEvents(TimerWheel *wheel) {
+    int newCapacity = (wheel->eventCapacity > 0) ? 2*wheel->eventCapacity : TIMER_WHEEL_START_CAPACITY;
+    TimerEvent *events = pushArray(wheel->arena, newCapacity, TimerEvent);
+    if(wheel->eventCapacity > 0) {
+        memcpy(events, wheel->events, sizeof(TimerEvent)*wheel->eventCapacity);
+    }
+    for(int eventIndex = newCapacity - 1; eventIndex >= wheel->eventCapacity; --eventIndex) {
+        events[eventIndex].slot = -1;
+        events[eventIndex].next = wheel->firstFreeEvent;
+        wheel->firstFreeEvent = eventIndex;
+    }
+    wheel->events = events;
+    wheel->eventCapacity = newCapacity;
+}
+
+//NOTE: Frees every event, currentTick keeps going.
+void clearTimerWheel(TimerWheel *wheel) {
+    wheel->eventCount = 0;
+    wheel->firedCount = 0;
+    wheel->firstFreeEvent = -1;
+    for(int eventIndex = wheel->eventCapacity - 1; eventIndex >= 0; --eventIndex) {
+        wheel->events[eventIndex].slot = -1;
+        wheel->events[eventIndex].next = wheel->firstFreeEvent;
+        wheel->firstFreeEvent = eventIndex;
+    }
+    for(int slot = 0; slot <= TIMER_WHEEL_OVERFLOW_SLOT; ++slot) {
+        wheel->slotHeads[slot] = -1;
+    }
+    for(int level = 0; level < TIMER_WHEEL_LEVEL_COUNT; ++level) {
+        wheel->occupied[level] = 0;
+    }
+}
+
+void initTimerWheel(TimerWheel *wheel, Arena *arena) {
+    zeroStruct(wheel, TimerWheel);
+    wheel->arena = arena;
+    wheel->firstFreeEvent = -1;
+    growTimerEvents(wheel);
+    clearTimerWheel(wheel);
+}
+
+//NOTE: A copy with its own pool pushed on arena.
+void copyTimerWheel(TimerWheel *dest, TimerWheel *src, Arena *arena) {
+    *dest = *src;
+    dest->arena = arena;
+    dest->events = pushArray(arena, src->eventCapacity, TimerEvent);
+    memcpy(dest->events, src->events, sizeof(TimerEvent)*src->eventCapacity);
+    dest->fired = pushArray(arena, src->firedCapacity, TimerEvent);
+    memcpy(dest->fired, src->fired, sizeof(TimerEvent)*src->firedCount);
+}
+
+//NOTE: Turns a frame's dt into whole ticks, keeping what is left over for next time.
+uint64_t getTimerWheelTicks(TimerWheel *wheel, float dt) {
+    wheel->tickRemainder += dt*TIMER_WHEEL_TICKS_PER_SECOND;
+    uint64_t result = (uint64_t)wheel->tickRemainder;
+    wheel->tickRemainder -= (float)result;
+    return result;
+}
+
+static inline int getTimerWheelSlot(TimerWheel *wheel, uint64_t fireTick) {
+    uint64_t difference = fireTick ^ wheel->currentTick;
+    int result = TIMER_WHEEL_OVERFLOW_SLOT;
+    for(int level = 0; level < TIMER_WHEEL_LEVEL_COUNT; ++level) {
+        if((difference >> (TIMER_WHEEL_SLOT_BITS*(level + 1))) == 0) {
+            result = level*TIMER_WHEEL_SLOT_COUNT + (int)((fireTick >> (TIMER_WHEEL_SLOT_BITS*level)) & (TIMER_WHEEL_SLOT_COUNT - 1));
+            break;
+        }
+    }
+    return result;
+}
+
+static void linkTimerEvent(TimerWheel *wheel, int eventIndex) {
+    TimerEvent *event = &wheel->events[eventIndex];
+    int slot = getTimerWheelSlot(wheel, event->fireTick);
+    event->slot = slot;
+    event->prev = -1;
+    event->next = wheel->slotHeads[slot];
+    if(event->next >= 0) {
+        wheel->events[event->next].prev = eventIndex;
+    }
+    wheel->slotHeads[slot] = eventIndex;
+    if(slot < TIMER_WHEEL_OVERFLOW_SLOT) {
+        wheel->occupied[slot / TIMER_WHEEL_SLOT_COUNT] |= (uint64_t)1 << (slot % TIMER_WHEEL_SLOT_COUNT);
+    }
+}
+
+static void unlinkTimerEvent(TimerWheel *wheel, int eventIndex) {
+    TimerEvent *event = &wheel->events[eventIndex];
+    int slot = event->slot;
+    if(event->prev >= 0) {
+        wheel->events[event->prev].next = event->next;
+    } else {
+        wheel->slotHeads[slot] = event->next;
+    }
+    if(event->next >= 0) {
+        wheel->events[event->next].prev = event->prev;
+    }
+    if(wheel->slotHeads[slot] < 0 && slot < TIMER_WHEEL_OVERFLOW_SLOT) {
+        wheel->occupied[slot / TIMER_WHEEL_SLOT_COUNT] &= ~((uint64_t)1 << (slot % TIMER_WHEEL_SLOT_COUNT));
+    }
+}
+
+static void freeTimerEvent(TimerWheel *wheel, int eventIndex) {
+    TimerEvent *event = &wheel->events[eventIndex];
+    event->slot = -1;
+    event->next = wheel->firstFreeEvent;
+    wheel->firstFreeEvent = eventIndex;
+    wheel->eventCount--;
+}
+
+//NOTE: Returns the event's index, for cancelTimerEvent. Events for now or the past fire on the next tick.
+int scheduleTimerEvent(TimerWheel *wheel, uint64_t fireTick, TimerEventType type, int data) {
+    if(wheel->firstFreeEvent < 0) {
+        growTimerEvents(wheel);
+    }
+    int eventIndex = wheel->firstFreeEvent;
+    TimerEvent *event = &wheel->events[eventIndex];
+    wheel->firstFreeEvent = event->next;
+    wheel->eventCount++;
+
+    event->fireTick = (fireTick > wheel->currentTick) ? fireTick : wheel->currentTick + 1;
+    event->type = type;
+    event->data = data;
+    linkTimerEvent(wheel, eventIndex);
+    return eventIndex;
+}
+
+void cancelTimerEvent(TimerWheel *wheel, int eventIndex) {
+    assert(eventIndex >= 0 && eventIndex < wheel->eventCapacity && wheel->events[eventIndex].slot >= 0);
+    unlinkTimerEvent(wheel, eventIndex);
+    freeTimerEvent(wheel, eventIndex);
+}
+
+//NOTE: Moves the events in a slot back through linkTimerEvent, which puts them on a lower level now the time is nearer.
+static void cascadeTimerSlot(TimerWheel *wheel, int slot) {
+    int eventIndex = wheel->slotHeads[slot];
+    wheel->slotHeads[slot] = -1;
+    if(slot < TIMER_WHEEL_OVERFLOW_SLOT) {
+        wheel->occupied[slot / TIMER_WHEEL_SLOT_COUNT] &= ~((uint64_t)1 << (slot % TIMER_WHEEL_SLOT_COUNT));
+    }
+    while(eventIndex >= 0) {
+        int nextIndex = wheel->events[eventIndex].next;
+        linkTimerEvent(wheel, eventIndex);
+        eventIndex = nextIndex;
+    }
+}
+
+static void addFiredTimerEvent(TimerWheel *wheel, TimerEvent *event) {
+    if(wheel->firedCount == wheel->firedCapacity) {
+        int newCapacity = (wheel->firedCapacity > 0) ? 2*wheel->firedCapacity : TIMER_WHEEL_START_CAPACITY;
+        TimerEvent *fired = pushArray(wheel->arena, newCapacity, TimerEvent);
+        memcpy(fired, wheel->fired, sizeof(TimerEvent)*wheel->firedCount);
+        wheel->fired = fired;
+        wheel->firedCapacity = newCapacity;
+    }
+    wheel->fired[wheel->firedCount++] = *event;
+}
+
+//NOTE: Moves time on by tickCount ticks. The events that came due are in wheel->fired afterwards.
+void advanceTimerWheel(TimerWheel *wheel, uint64_t tickCount) {
+    wheel->firedCount = 0;
+    uint64_t endTick = wheel->currentTick + tickCount;
+    while(wheel->currentTick < endTick) {
+        if(wheel->eventCount == 0) {
+            wheel->currentTick = endTick;
+            break;
+        }
+        if(!wheel->occupied[0]) {
+            //NOTE: nothing left on level 0, skip to the tick before it comes round
+            uint64_t skipTick = wheel->currentTick | (TIMER_WHEEL_SLOT_COUNT - 1);
+            if(skipTick >= endTick) {
+                wheel->currentTick = endTick;
+                break;
+            }
+            wheel->currentTick = skipTick;
+        }
+        uint64_t tick = ++wheel->currentTick;
+
+        //NOTE: the highest level that came round first, so its events can carry on down
+        if((tick & (TIMER_WHEEL_SLOT_COUNT - 1)) == 0) {
+            if((tick & (((uint64_t)1 << (TIMER_WHEEL_SLOT_BITS*TIMER_WHEEL_LEVEL_COUNT)) - 1)) == 0) {
+                cascadeTimerSlot(wheel, TIMER_WHEEL_OVERFLOW_SLOT);
+            }
+            for(int level = TIMER_WHEEL_LEVEL_COUNT - 1; level >= 1; --level) {
+                uint64_t levelMask = ((uint64_t)1 << (TIMER_WHEEL_SLOT_BITS*level)) - 1;
+                if((tick & levelMask) == 0) {
+                    int slot = (int)((tick >> (TIMER_WHEEL_SLOT_BITS*level)) & (TIMER_WHEEL_SLOT_COUNT - 1));
+                    cascadeTimerSlot(wheel, level*TIMER_WHEEL_SLOT_COUNT + slot);
+                }
+            }
+        }
+
+        int slot = (int)(tick & (TIMER_WHEEL_SLOT_COUNT - 1));
+        int eventIndex = wheel->slotHeads[slot];
+        wheel->slotHeads[slot] = -1;
+        wheel->occupied[0] &= ~((uint64_t)1 << slot);
+        while(eventIndex >= 0) {
+            TimerEvent *event = &wheel->events[eventIndex];
+            int nextIndex = event->next;
+            assert(event->fireTick == tick);
+            addFiredTimerEvent(wheel, event);
+            freeTimerEvent(wheel, eventIndex);
+            eventIndex = nextIndex;
+        }
+    }
+}